@@ -1,52 +1,223 @@
 #include "devices/input.h"
 #include <debug.h>
-#include "devices/intq.h"
 #include "devices/serial.h"
+#include "threads/interrupt.h"
+#include "threads/waitq.h"
+#ifdef USERPROG
+#include "userprog/process.h"
+#endif
 
-/* Stores keys from the keyboard and serial port. */
-static struct intq buffer;
+/* Line discipline for keys from the keyboard and serial port.
+
+   In canonical mode, the default, keys are collected into a line
+   that can be edited with backspace and Ctrl+U, and become
+   readable only once the line is ended by Enter or Ctrl+D.
+   Ctrl+D on an empty line makes the next read return end of
+   file.  Carriage returns are turned into new-lines.  In raw
+   mode every key is readable as soon as it arrives, unchanged.
+   Keys are not echoed in either mode.
+
+   Keys are stored in a ring buffer.  Keys from TAIL up to EDIT
+   are readable; keys from EDIT up to HEAD are the line still
+   being edited.  All three positions are taken modulo
+   INPUT_BUFSIZE.  Interrupts must be off to access them. */
+#define INPUT_BUFSIZE 1024      /* Must be a power of 2. */
+
+static uint8_t buffer[INPUT_BUFSIZE];
+static unsigned head, edit, tail;
+static bool eof;                /* Ctrl+D on an empty line, not yet read. */
+static bool canonical = true;   /* Canonical or raw mode. */
+
+/* Threads waiting for keys to read. */
+static struct wait_queue pollers;
 
 /* Initializes the input buffer. */
 void
-input_init (void) 
+input_init (void)
+{
+  wait_queue_init (&pollers);
+}
+
+/* Makes the line being edited readable and wakes up readers. */
+static void
+commit (void)
 {
-  intq_init (&buffer);
+  edit = head;
+  wait_queue_wake (&pollers);
 }
 
 /* Adds a key to the input buffer.
    Interrupts must be off and the buffer must not be full. */
 void
-input_putc (uint8_t key) 
+input_putc (uint8_t key)
 {
   ASSERT (intr_get_level () == INTR_OFF);
-  ASSERT (!intq_full (&buffer));
+  ASSERT (!input_full ());
+
+  if (!canonical)
+    {
+      buffer[head++ % INPUT_BUFSIZE] = key;
+      commit ();
+    }
+  else
+    switch (key)
+      {
+      case '\b': case 0x7f:     /* Backspace, Delete: erase a key. */
+        if (head != edit)
+          head--;
+        break;
+
+      case 0x15:                /* Ctrl+U: erase the line. */
+        head = edit;
+        break;
+
+      case 0x04:                /* Ctrl+D: end the line, or the input. */
+        if (head == edit)
+          eof = true;
+        commit ();
+        break;
+
+      case '\r': case '\n':     /* Enter: end the line. */
+        buffer[head++ % INPUT_BUFSIZE] = '\n';
+        commit ();
+        break;
+
+      default:
+        buffer[head++ % INPUT_BUFSIZE] = key;
 
-  intq_putc (&buffer, key);
+        /* A line that fills the buffer could never be ended. */
+        if (input_full ())
+          commit ();
+        break;
+      }
   serial_notify ();
 }
 
-/* Retrieves a key from the input buffer.
-   If the buffer is empty, waits for a key to be pressed. */
-uint8_t
-input_getc (void) 
+/* Returns true if the running thread should stop waiting for
+   keys because its process is going down. */
+static bool
+stop_waiting (void)
+{
+#ifdef USERPROG
+  return process_poll_exit (NULL, NULL);
+#else
+  return false;
+#endif
+}
+
+/* Reads up to SIZE readable keys into BUFFER_, stopping after a
+   new-line.  If no key is readable and BLOCK is true, first waits
+   until one is, or for end of file.  Returns the number of keys
+   read, 0 at end of file, if BLOCK is false and no key is
+   readable, or if the running thread's process starts going
+   down while waiting. */
+size_t
+input_read (void *buffer_, size_t size, bool block)
 {
+  uint8_t *dst = buffer_;
+  struct wait_entry e;
+#ifdef USERPROG
+  struct wait_entry exit_e;
+#endif
+  struct waiter w;
   enum intr_level old_level;
-  uint8_t key;
+  size_t n = 0;
 
+  ASSERT (!intr_context ());
+
+  if (size == 0)
+    return 0;
+
+  if (block)
+    {
+      waiter_init (&w);
+      wait_queue_add (&pollers, &e, &w);
+#ifdef USERPROG
+      process_poll_exit (&exit_e, &w);
+#endif
+    }
   old_level = intr_disable ();
-  key = intq_getc (&buffer);
+  while (block && tail == edit && !eof && !stop_waiting ())
+    waiter_sleep (&w, -1);
+
+  while (n < size && tail != edit)
+    {
+      uint8_t key = buffer[tail++ % INPUT_BUFSIZE];
+      dst[n++] = key;
+      if (key == '\n')
+        break;
+    }
+  if (block && n == 0)
+    eof = false;
   serial_notify ();
   intr_set_level (old_level);
-  
+
+  if (block)
+    {
+#ifdef USERPROG
+      wait_queue_remove (&exit_e);
+#endif
+      wait_queue_remove (&e);
+    }
+  return n;
+}
+
+/* Retrieves a key from the input buffer.
+   If the buffer is empty, waits for a key to be pressed.
+   Returns 0 if the running thread's process starts going down
+   while waiting. */
+uint8_t
+input_getc (void)
+{
+  uint8_t key;
+
+  while (input_read (&key, 1, true) == 0)
+    if (stop_waiting ())
+      return 0;
   return key;
 }
 
+/* Switches to canonical mode if CANONICAL is true, otherwise to
+   raw mode, in which the line being edited becomes readable.
+   Returns true if the old mode was canonical. */
+bool
+input_set_canonical (bool new_canonical)
+{
+  enum intr_level old_level;
+  bool old_canonical;
+
+  old_level = intr_disable ();
+  old_canonical = canonical;
+  canonical = new_canonical;
+  if (!canonical && edit != head)
+    commit ();
+  intr_set_level (old_level);
+  return old_canonical;
+}
+
+/* Returns true if a key or end of file is waiting to be read.
+   If W is non-null, also makes W wait, through E, for keys to
+   arrive, until E is removed with wait_queue_remove(). */
+bool
+input_poll (struct wait_entry *e, struct waiter *w)
+{
+  enum intr_level old_level;
+  bool ready;
+
+  if (w != NULL)
+    wait_queue_add (&pollers, e, w);
+  old_level = intr_disable ();
+  ready = tail != edit || eof;
+  intr_set_level (old_level);
+  return ready;
+}
+
 /* Returns true if the input buffer is full,
    false otherwise.
    Interrupts must be off. */
 bool
-input_full (void) 
+input_full (void)
 {
   ASSERT (intr_get_level () == INTR_OFF);
-  return intq_full (&buffer);
+  return head - tail == INPUT_BUFSIZE;
 }
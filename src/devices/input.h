@@ -2,11 +2,18 @@
 #define DEVICES_INPUT_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 void input_init (void);
 void input_putc (uint8_t);
 uint8_t input_getc (void);
+size_t input_read (void *, size_t, bool block);
+bool input_set_canonical (bool);
 bool input_full (void);
 
+struct wait_entry;
+struct waiter;
+bool input_poll (struct wait_entry *, struct waiter *);
+
 #endif /* devices/input.h */
@@ -1,7 +1,6 @@
 #include "devices/serial.h"
 #include <debug.h>
 #include "devices/input.h"
-#include "devices/intq.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
@@ -33,6 +32,10 @@
 #define MCR_REG (IO_BASE + 4)   /* MODEM Control Register. */
 #define LSR_REG (IO_BASE + 5)   /* Line Status Register (read-only). */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable FIFOs. */
+#define FCR_CLEAR 0x06          /* Clear receive and transmit FIFOs. */
+
 /* Interrupt Enable Register bits. */
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
@@ -51,11 +54,29 @@
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
-/* Data to be transmitted. */
-static struct intq txq;
+/* Depth of the 16550A transmit FIFO, in bytes. */
+#define TX_FIFO_SIZE 16
+
+/* Transmit buffer size, in bytes.  Must be a power of 2. */
+#define TXBUF_SIZE 4096
+
+/* Data to be transmitted, a ring buffer that writers append to in
+   bulk and the interrupt handler drains into the UART's FIFO.
+   Bytes are added at TX_HEAD and removed at TX_TAIL, both taken
+   modulo TXBUF_SIZE.  Interrupts must be off to access them. */
+static uint8_t txbuf[TXBUF_SIZE];
+static unsigned tx_head, tx_tail;
+
+/* Threads waiting for room in TXBUF. */
+static struct semaphore tx_room;
+static int tx_waiters;
+
+/* Value last written to the IER. */
+static uint8_t ier;
 
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
+static void tx_drain (void);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
 
@@ -71,13 +92,15 @@ init_poll (void)
   outb (FCR_REG, 0);                    /* Disable FIFO. */
   set_serial (9600);                    /* 9.6 kbps, N-8-1. */
   outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
-  intq_init (&txq);
+  sema_init (&tx_room, 0);
   mode = POLL;
 } 
 
 /* Initializes the serial port device for queued interrupt-driven
    I/O.  With interrupt-driven I/O we don't waste CPU time
-   waiting for the serial device to become ready. */
+   waiting for the serial device to become ready, and with the
+   FIFOs enabled each transmit interrupt sends a run of bytes
+   instead of one. */
 void
 serial_init_queue (void) 
 {
@@ -88,6 +111,7 @@ serial_init_queue (void)
   ASSERT (mode == POLL);
 
   intr_register_ext (0x20 + 4, serial_interrupt, "serial");
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR);
   mode = QUEUE;
   old_level = intr_disable ();
   write_ier ();
@@ -98,32 +122,58 @@ serial_init_queue (void)
 void
 serial_putc (uint8_t byte) 
 {
+  serial_putbuf (&byte, 1);
+}
+
+/* Sends the SIZE bytes in BUFFER to the serial port. */
+void
+serial_putbuf (const void *buffer, size_t size) 
+{
+  const uint8_t *p = buffer;
   enum intr_level old_level = intr_disable ();
 
   if (mode != QUEUE)
     {
       /* If we're not set up for interrupt-driven I/O yet,
-         use dumb polling to transmit a byte. */
+         use dumb polling to transmit. */
       if (mode == UNINIT)
         init_poll ();
-      putc_poll (byte); 
+      while (size-- > 0)
+        putc_poll (*p++);
     }
   else 
     {
-      /* Otherwise, queue a byte and update the interrupt enable
-         register. */
-      if (old_level == INTR_OFF && intq_full (&txq)) 
+      /* Otherwise, queue as much as fits, start transmitting, and
+         update the interrupt enable register. */
+      while (size > 0)
         {
-          /* Interrupts are off and the transmit queue is full.
-             If we wanted to wait for the queue to empty,
-             we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
-          putc_poll (intq_getc (&txq)); 
+          if (tx_head - tx_tail == TXBUF_SIZE) 
+            {
+              if (old_level == INTR_OFF)
+                {
+                  /* Interrupts are off and the transmit buffer is
+                     full.  If we wanted to wait for it to drain,
+                     we'd have to reenable interrupts.  That's
+                     impolite, so we'll send a character via
+                     polling instead. */
+                  putc_poll (txbuf[tx_tail++ % TXBUF_SIZE]);
+                }
+              else
+                {
+                  tx_waiters++;
+                  sema_down (&tx_room);
+                }
+              continue;
+            }
+
+          while (size > 0 && tx_head - tx_tail < TXBUF_SIZE)
+            {
+              txbuf[tx_head++ % TXBUF_SIZE] = *p++;
+              size--;
+            }
+          tx_drain ();
+          write_ier ();
         }
-
-      intq_putc (&txq, byte); 
-      write_ier ();
     }
   
   intr_set_level (old_level);
@@ -135,8 +185,8 @@ void
 serial_flush (void) 
 {
   enum intr_level old_level = intr_disable ();
-  while (!intq_empty (&txq))
-    putc_poll (intq_getc (&txq));
+  while (tx_head != tx_tail)
+    putc_poll (txbuf[tx_tail++ % TXBUF_SIZE]);
   intr_set_level (old_level);
 }
 
@@ -172,25 +222,45 @@ set_serial (int bps)
   outb (LCR_REG, LCR_N81);
 }
 
-/* Update interrupt enable register. */
+/* Update interrupt enable register, if it changes. */
 static void
 write_ier (void) 
 {
-  uint8_t ier = 0;
+  uint8_t new_ier = 0;
 
   ASSERT (intr_get_level () == INTR_OFF);
 
   /* Enable transmit interrupt if we have any characters to
      transmit. */
-  if (!intq_empty (&txq))
-    ier |= IER_XMIT;
+  if (tx_head != tx_tail)
+    new_ier |= IER_XMIT;
 
   /* Enable receive interrupt if we have room to store any
      characters we receive. */
   if (!input_full ())
-    ier |= IER_RECV;
+    new_ier |= IER_RECV;
   
-  outb (IER_REG, ier);
+  if (new_ier != ier)
+    {
+      ier = new_ier;
+      outb (IER_REG, ier);
+    }
+}
+
+/* If the UART's transmit FIFO is empty, refills it from the
+   transmit buffer. */
+static void
+tx_drain (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (tx_head != tx_tail && (inb (LSR_REG) & LSR_THRE) != 0)
+    {
+      int i;
+
+      for (i = 0; i < TX_FIFO_SIZE && tx_head != tx_tail; i++)
+        outb (THR_REG, txbuf[tx_tail++ % TXBUF_SIZE]);
+    }
 }
 
 /* Polls the serial port until it's ready,
@@ -218,10 +288,14 @@ serial_interrupt (struct intr_frame *f UNUSED)
   while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
     input_putc (inb (RBR_REG));
 
-  /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
-  while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
-    outb (THR_REG, intq_getc (&txq));
+  /* Refill the transmit FIFO, and let writers waiting for room
+     try again. */
+  tx_drain ();
+  while (tx_waiters > 0)
+    {
+      tx_waiters--;
+      sema_up (&tx_room);
+    }
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
@@ -26,6 +26,7 @@ static size_t cx, cy;
    The attribute at (x,y) is fb[y][x][1]. */
 static uint8_t (*fb)[COL_CNT][2];
 
+static void putc_nocursor (int c, enum intr_level old_level);
 static void clear_row (size_t y);
 static void cls (void);
 static void newline (void);
@@ -56,7 +57,34 @@ vga_putc (int c)
   enum intr_level old_level = intr_disable ();
 
   init ();
-  
+  putc_nocursor (c, old_level);
+  move_cursor ();
+
+  intr_set_level (old_level);
+}
+
+/* Writes the SIZE characters in BUFFER to the VGA text display
+   like vga_putc(), but moves the hardware cursor only once, at
+   the end. */
+void
+vga_putbuf (const char *buffer, size_t size)
+{
+  enum intr_level old_level = intr_disable ();
+
+  init ();
+  while (size-- > 0)
+    putc_nocursor (*buffer++, old_level);
+  move_cursor ();
+
+  intr_set_level (old_level);
+}
+
+/* Writes C to the framebuffer at the cursor and advances the
+   cursor, without moving the hardware cursor.  Interrupts must
+   be off; OLD_LEVEL is the level to restore while beeping. */
+static void
+putc_nocursor (int c, enum intr_level old_level)
+{
   switch (c) 
     {
     case '\n':
@@ -95,14 +123,10 @@ vga_putc (int c)
         newline ();
       break;
     }
-
-  /* Update cursor position. */
-  move_cursor ();
-
-  intr_set_level (old_level);
 }
-
-/* Clears the screen and moves the cursor to the upper left. */
+
+/* Clears the screen and moves the cursor to the upper left.
+   The caller moves the hardware cursor. */
 static void
 cls (void)
 {
@@ -112,7 +136,6 @@ cls (void)
     clear_row (y);
 
   cx = cy = 0;
-  move_cursor ();
 }
 
 /* Clears row Y to spaces. */
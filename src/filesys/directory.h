@@ -30,11 +30,13 @@ struct dir_entry
 struct inode;
 
 /* Opening and closing directories. */
+void dir_init (void);
 bool dir_create (block_sector_t sector, size_t entry_cnt, struct dir *parent);
 struct dir *dir_open (struct inode *);
 struct dir *dir_open_root (void);
 struct dir *dir_reopen (struct dir *);
 void dir_close (struct dir *);
+void dir_free (struct dir *);
 struct inode *dir_get_inode (struct dir *);
 
 /* Reading and writing. */
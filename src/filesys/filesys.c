@@ -24,6 +24,8 @@ filesys_init (bool format)
     PANIC ("No file system device found, can't initialize file system.");
 
   inode_init ();
+  file_init ();
+  dir_init ();
   free_map_init ();
 
   if (format)
@@ -98,8 +100,10 @@ filesys_chdir(const char *path)
 		return false;
 	}
 
-	dir_close(thread_current()->directory);
-	thread_current()->directory = dir;
+	// cwd is shared by all threads of the process
+	struct thread *t = thread_leader(thread_current());
+	dir_close(t->directory);
+	t->directory = dir;
 
 	free(include_dir);
 	return true;
@@ -184,10 +188,11 @@ struct dir *dir_from_path(const char *path)
 
 	memcpy(buf, path, strlen(path)+1);
 
-	if(thread_current()->directory == NULL || path[0] == '/')
+	struct dir *cwd = thread_leader(thread_current())->directory;
+	if(cwd == NULL || path[0] == '/')
 		dir = dir_open_root();
 	else
-		dir = dir_reopen(thread_current()->directory);
+		dir = dir_reopen(cwd);
 
 	if(dir->inode->removed)
 		return NULL;
@@ -3,6 +3,8 @@
 #include <limits.h>
 #include <round.h>
 #include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
 #ifdef FILESYS
 #include "filesys/file.h"
@@ -23,11 +25,19 @@ typedef unsigned long elem_type;
 
 /* From the outside, a bitmap is an array of bits.  From the
    inside, it's an array of elem_type (defined above) that
-   simulates an array of bits. */
+   simulates an array of bits.
+
+   A two-level summary is kept alongside the bits: bit I of
+   NONZERO is set if element I of BITS has any bit set, and bit I
+   of FULL is set if every bit of element I is set.  Scans use it
+   to step over ELEM_BITS elements (ELEM_BITS squared bits) at a
+   time that cannot start or continue a run. */
 struct bitmap
   {
     size_t bit_cnt;     /* Number of bits. */
     elem_type *bits;    /* Elements that represent bits. */
+    elem_type *nonzero; /* Summary: elements with any bit set. */
+    elem_type *full;    /* Summary: elements with all bits set. */
   };
 
 /* Returns the index of the element that contains the bit
@@ -60,6 +70,14 @@ byte_cnt (size_t bit_cnt)
   return sizeof (elem_type) * elem_cnt (bit_cnt);
 }
 
+/* Returns the number of bytes required for the summary of a
+   bitmap with BIT_CNT bits, both levels together. */
+static inline size_t
+summary_byte_cnt (size_t bit_cnt)
+{
+  return 2 * byte_cnt (elem_cnt (bit_cnt));
+}
+
 /* Returns a bit mask in which the bits actually used in the last
    element of B's bits are set to 1 and the rest are set to 0. */
 static inline elem_type
@@ -68,6 +86,146 @@ last_mask (const struct bitmap *b)
   int last_bits = b->bit_cnt % ELEM_BITS;
   return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
+
+/* Returns the mask of the bits of element IDX of B that are
+   part of the bitmap. */
+static inline elem_type
+valid_mask (const struct bitmap *b, size_t idx)
+{
+  return idx == elem_cnt (b->bit_cnt) - 1 ? last_mask (b) : (elem_type) -1;
+}
+
+/* Returns the index of the lowest set bit in nonzero ELEM. */
+static inline size_t
+lowest_bit (elem_type elem)
+{
+  return __builtin_ctzl (elem);
+}
+
+/* Returns the number of set bits in ELEM.  Computed by hand
+   because the builtin may call into libgcc, which the kernel
+   does not link against. */
+static inline size_t
+pop_count (elem_type elem)
+{
+  size_t cnt = 0;
+  for (; elem != 0; elem &= elem - 1)
+    cnt++;
+  return cnt;
+}
+
+/* Returns element IDX of B with each bit set to VALUE turned on
+   and every other bit, including bits past the end of B, turned
+   off. */
+static inline elem_type
+value_elem (const struct bitmap *b, size_t idx, bool value)
+{
+  elem_type elem = value ? b->bits[idx] : ~b->bits[idx];
+  return elem & valid_mask (b, idx);
+}
+
+/* Returns summary element SIDX of B with bit I turned on if
+   element SIDX * ELEM_BITS + I of B may contain a bit set to
+   VALUE. */
+static inline elem_type
+value_summary (const struct bitmap *b, size_t sidx, bool value)
+{
+  return value ? b->nonzero[sidx] : ~b->full[sidx];
+}
+
+/* Brings the summary bits for element IDX of B up to date.
+   Must be called with interrupts off, so that the element and
+   its summary change together. */
+static void
+update_summary (struct bitmap *b, size_t idx)
+{
+  elem_type elem = b->bits[idx];
+
+  if (elem != 0)
+    b->nonzero[elem_idx (idx)] |= bit_mask (idx);
+  else
+    b->nonzero[elem_idx (idx)] &= ~bit_mask (idx);
+
+  if (elem == valid_mask (b, idx))
+    b->full[elem_idx (idx)] |= bit_mask (idx);
+  else
+    b->full[elem_idx (idx)] &= ~bit_mask (idx);
+}
+
+#ifdef FILESYS
+/* Recomputes all of B's summary from its bits. */
+static void
+rebuild_summary (struct bitmap *b)
+{
+  enum intr_level old_level = intr_disable ();
+  size_t i;
+
+  for (i = 0; i < elem_cnt (b->bit_cnt); i++)
+    update_summary (b, i);
+  intr_set_level (old_level);
+}
+#endif /* FILESYS */
+
+/* Sets the bits in MASK in element IDX of B to VALUE, atomically
+   with respect to the summary. */
+static void
+set_elem_bits (struct bitmap *b, size_t idx, elem_type mask, bool value)
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (value)
+    b->bits[idx] |= mask;
+  else
+    b->bits[idx] &= ~mask;
+  update_summary (b, idx);
+  intr_set_level (old_level);
+}
+
+/* Returns the index of the first bit in B at or after START and
+   before END that is set to VALUE, or END if there is none. */
+static size_t
+next_bit (const struct bitmap *b, size_t start, size_t end, bool value)
+{
+  size_t idx, sidx;
+  elem_type elem, summary;
+
+  if (start >= end)
+    return end;
+
+  /* Rest of the element that holds START. */
+  idx = elem_idx (start);
+  elem = value_elem (b, idx, value) & ~(bit_mask (start) - 1);
+  if (elem != 0)
+    goto found;
+
+  /* Later elements, found through the summary. */
+  idx++;
+  if (idx * ELEM_BITS >= end)
+    return end;
+  sidx = elem_idx (idx);
+  summary = value_summary (b, sidx, value) & ~(bit_mask (idx) - 1);
+  for (;;)
+    {
+      while (summary == 0)
+        {
+          sidx++;
+          if (sidx * ELEM_BITS * ELEM_BITS >= end)
+            return end;
+          summary = value_summary (b, sidx, value);
+        }
+      idx = sidx * ELEM_BITS + lowest_bit (summary);
+      if (idx * ELEM_BITS >= end)
+        return end;
+      elem = value_elem (b, idx, value);
+      if (elem != 0)
+        goto found;
+      summary &= summary - 1;
+    }
+
+ found:
+  start = idx * ELEM_BITS + lowest_bit (elem);
+  return start < end ? start : end;
+}
 
 /* Creation and destruction. */
 
@@ -82,9 +240,12 @@ bitmap_create (size_t bit_cnt)
   if (b != NULL)
     {
       b->bit_cnt = bit_cnt;
-      b->bits = malloc (byte_cnt (bit_cnt));
+      b->bits = malloc (byte_cnt (bit_cnt) + summary_byte_cnt (bit_cnt));
       if (b->bits != NULL || bit_cnt == 0)
         {
+          b->nonzero = b->bits + elem_cnt (bit_cnt);
+          b->full = b->nonzero + elem_cnt (elem_cnt (bit_cnt));
+          memset (b->nonzero, 0, summary_byte_cnt (bit_cnt));
           bitmap_set_all (b, false);
           return b;
         }
@@ -105,6 +266,9 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED)
 
   b->bit_cnt = bit_cnt;
   b->bits = (elem_type *) (b + 1);
+  b->nonzero = b->bits + elem_cnt (bit_cnt);
+  b->full = b->nonzero + elem_cnt (elem_cnt (bit_cnt));
+  memset (b->nonzero, 0, summary_byte_cnt (bit_cnt));
   bitmap_set_all (b, false);
   return b;
 }
@@ -114,7 +278,8 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED)
 size_t
 bitmap_buf_size (size_t bit_cnt) 
 {
-  return sizeof (struct bitmap) + byte_cnt (bit_cnt);
+  return sizeof (struct bitmap) + byte_cnt (bit_cnt)
+         + summary_byte_cnt (bit_cnt);
 }
 
 /* Destroys bitmap B, freeing its storage.
@@ -156,26 +321,14 @@ bitmap_set (struct bitmap *b, size_t idx, bool value)
 void
 bitmap_mark (struct bitmap *b, size_t bit_idx) 
 {
-  size_t idx = elem_idx (bit_idx);
-  elem_type mask = bit_mask (bit_idx);
-
-  /* This is equivalent to `b->bits[idx] |= mask' except that it
-     is guaranteed to be atomic on a uniprocessor machine.  See
-     the description of the OR instruction in [IA32-v2b]. */
-  asm ("orl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+  set_elem_bits (b, elem_idx (bit_idx), bit_mask (bit_idx), true);
 }
 
 /* Atomically sets the bit numbered BIT_IDX in B to false. */
 void
 bitmap_reset (struct bitmap *b, size_t bit_idx) 
 {
-  size_t idx = elem_idx (bit_idx);
-  elem_type mask = bit_mask (bit_idx);
-
-  /* This is equivalent to `b->bits[idx] &= ~mask' except that it
-     is guaranteed to be atomic on a uniprocessor machine.  See
-     the description of the AND instruction in [IA32-v2a]. */
-  asm ("andl %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+  set_elem_bits (b, elem_idx (bit_idx), bit_mask (bit_idx), false);
 }
 
 /* Atomically toggles the bit numbered IDX in B;
@@ -186,11 +339,11 @@ bitmap_flip (struct bitmap *b, size_t bit_idx)
 {
   size_t idx = elem_idx (bit_idx);
   elem_type mask = bit_mask (bit_idx);
+  enum intr_level old_level = intr_disable ();
 
-  /* This is equivalent to `b->bits[idx] ^= mask' except that it
-     is guaranteed to be atomic on a uniprocessor machine.  See
-     the description of the XOR instruction in [IA32-v2b]. */
-  asm ("xorl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+  b->bits[idx] ^= mask;
+  update_summary (b, idx);
+  intr_set_level (old_level);
 }
 
 /* Returns the value of the bit numbered IDX in B. */
@@ -213,18 +366,28 @@ bitmap_set_all (struct bitmap *b, bool value)
   bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.
+   Works an element at a time; each element is set atomically. */
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
+  size_t end = start + cnt;
   
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set (b, start + i, value);
+  while (start < end)
+    {
+      size_t idx = elem_idx (start);
+      size_t ofs = start % ELEM_BITS;
+      size_t n = end - start < ELEM_BITS - ofs ? end - start : ELEM_BITS - ofs;
+      elem_type mask = n == ELEM_BITS ? (elem_type) -1
+                                      : (((elem_type) 1 << n) - 1) << ofs;
+
+      set_elem_bits (b, idx, mask, value);
+      start += n;
+    }
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -239,9 +402,17 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
   ASSERT (start + cnt <= b->bit_cnt);
 
   value_cnt = 0;
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      value_cnt++;
+  for (i = start; i < start + cnt; )
+    {
+      size_t ofs = i % ELEM_BITS;
+      size_t n = start + cnt - i < ELEM_BITS - ofs ? start + cnt - i
+                                                  : ELEM_BITS - ofs;
+      elem_type elem = value_elem (b, elem_idx (i), value) >> ofs;
+      if (n < ELEM_BITS)
+        elem &= ((elem_type) 1 << n) - 1;
+      value_cnt += pop_count (elem);
+      i += n;
+    }
   return value_cnt;
 }
 
@@ -250,16 +421,11 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
-  
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
-  return false;
+  return next_bit (b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -291,20 +457,32 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt)
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
-   If there is no such group, returns BITMAP_ERROR. */
+   If there is no such group, returns BITMAP_ERROR.
+
+   Each candidate run starts at the next bit set to VALUE and is
+   cut short at the next bit set to !VALUE, where the search
+   resumes, so no bit is examined twice. */
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
-  if (cnt <= b->bit_cnt) 
+  if (cnt == 0)
+    return start;
+
+  while (cnt <= b->bit_cnt && start <= b->bit_cnt - cnt)
     {
-      size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
+      size_t end;
+
+      start = next_bit (b, start, b->bit_cnt - cnt + 1, value);
+      if (start > b->bit_cnt - cnt)
+        break;
+
+      end = next_bit (b, start, start + cnt, !value);
+      if (end == start + cnt)
+        return start;
+      start = end;
     }
   return BITMAP_ERROR;
 }
@@ -346,6 +524,7 @@ bitmap_read (struct bitmap *b, struct file *file)
       off_t size = byte_cnt (b->bit_cnt);
       success = file_read_at (file, b->bits, size, 0) == size;
       b->bits[elem_cnt (b->bit_cnt) - 1] &= last_mask (b);
+      rebuild_summary (b);
     }
   return success;
 }
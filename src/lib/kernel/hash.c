@@ -18,6 +18,7 @@ static struct hash_elem *find_elem (struct hash *, struct list *,
 static void insert_elem (struct hash *, struct list *, struct hash_elem *);
 static void remove_elem (struct hash *, struct hash_elem *);
 static void rehash (struct hash *);
+static void migrate_buckets (struct hash *, size_t cnt);
 
 /* Initializes hash table H to compute hash values using HASH and
    compare hash elements using LESS, given auxiliary data AUX. */
@@ -28,6 +29,9 @@ hash_init (struct hash *h,
   h->elem_cnt = 0;
   h->bucket_cnt = 4;
   h->buckets = malloc (sizeof *h->buckets * h->bucket_cnt);
+  h->old_buckets = NULL;
+  h->old_bucket_cnt = 0;
+  h->migrate_idx = 0;
   h->hash = hash;
   h->less = less;
   h->aux = aux;
@@ -55,6 +59,7 @@ hash_clear (struct hash *h, hash_action_func *destructor)
 {
   size_t i;
 
+  migrate_buckets (h, SIZE_MAX);
   for (i = 0; i < h->bucket_cnt; i++) 
     {
       struct list *bucket = &h->buckets[i];
@@ -88,6 +93,7 @@ hash_destroy (struct hash *h, hash_action_func *destructor)
 {
   if (destructor != NULL)
     hash_clear (h, destructor);
+  free (h->old_buckets);
   free (h->buckets);
 }
 
@@ -166,6 +172,7 @@ hash_apply (struct hash *h, hash_action_func *action)
   
   ASSERT (action != NULL);
 
+  migrate_buckets (h, SIZE_MAX);
   for (i = 0; i < h->bucket_cnt; i++) 
     {
       struct list *bucket = &h->buckets[i];
@@ -202,6 +209,7 @@ hash_first (struct hash_iterator *i, struct hash *h)
   ASSERT (i != NULL);
   ASSERT (h != NULL);
 
+  migrate_buckets (h, SIZE_MAX);
   i->hash = h;
   i->bucket = i->hash->buckets;
   i->elem = list_elem_to_hash_elem (list_head (i->bucket));
@@ -301,12 +309,20 @@ hash_int (int i)
   return hash_bytes (&i, sizeof i);
 }
 
-/* Returns the bucket in H that E belongs in. */
+/* Returns the bucket in H that E belongs in.  While H is being
+   resized, that is the old bucket if it has not been moved yet. */
 static struct list *
 find_bucket (struct hash *h, struct hash_elem *e) 
 {
-  size_t bucket_idx = h->hash (e, h->aux) & (h->bucket_cnt - 1);
-  return &h->buckets[bucket_idx];
+  unsigned hash = h->hash (e, h->aux);
+
+  if (h->old_buckets != NULL)
+    {
+      size_t old_idx = hash & (h->old_bucket_cnt - 1);
+      if (old_idx >= h->migrate_idx)
+        return &h->old_buckets[old_idx];
+    }
+  return &h->buckets[hash & (h->bucket_cnt - 1)];
 }
 
 /* Searches BUCKET in H for a hash element equal to E.  Returns
@@ -325,54 +341,83 @@ find_elem (struct hash *h, struct list *bucket, struct hash_elem *e)
   return NULL;
 }
 
-/* Returns X with its lowest-order bit set to 1 turned off. */
-static inline size_t
-turn_off_least_1bit (size_t x) 
-{
-  return x & (x - 1);
-}
-
-/* Returns true if X is a power of 2, otherwise false. */
-static inline size_t
-is_power_of_2 (size_t x) 
-{
-  return x != 0 && turn_off_least_1bit (x) == 0;
-}
-
 /* Element per bucket ratios. */
 #define MIN_ELEMS_PER_BUCKET  1 /* Elems/bucket < 1: reduce # of buckets. */
 #define BEST_ELEMS_PER_BUCKET 2 /* Ideal elems/bucket. */
 #define MAX_ELEMS_PER_BUCKET  4 /* Elems/bucket > 4: increase # of buckets. */
 
-/* Changes the number of buckets in hash table H to match the
-   ideal.  This function can fail because of an out-of-memory
-   condition, but that'll just make hash accesses less efficient;
-   we can still continue. */
+/* Old buckets moved by each insertion or deletion while the
+   table is being resized.  Must be at least 2 so that a resize
+   always finishes before the table could need another one. */
+#define MIGRATE_STEP 2
+
+/* Moves up to CNT old buckets of H into the current bucket
+   array, and frees the old array once it is empty. */
+static void
+migrate_buckets (struct hash *h, size_t cnt) 
+{
+  if (h->old_buckets == NULL)
+    return;
+
+  for (; cnt > 0 && h->migrate_idx < h->old_bucket_cnt; cnt--)
+    {
+      struct list *old_bucket = &h->old_buckets[h->migrate_idx++];
+
+      while (!list_empty (old_bucket))
+        {
+          struct list_elem *elem = list_pop_front (old_bucket);
+          struct hash_elem *e = list_elem_to_hash_elem (elem);
+          size_t idx = h->hash (e, h->aux) & (h->bucket_cnt - 1);
+          list_push_front (&h->buckets[idx], elem);
+        }
+    }
+
+  if (h->migrate_idx >= h->old_bucket_cnt) 
+    {
+      free (h->old_buckets);
+      h->old_buckets = NULL;
+      h->old_bucket_cnt = 0;
+      h->migrate_idx = 0;
+    }
+}
+
+/* Moves a few more buckets of an ongoing resize of hash table H,
+   or starts a resize if H has strayed too far from the ideal
+   number of elements per bucket.  This function can fail
+   because of an out-of-memory condition, but that'll just make
+   hash accesses less efficient; we can still continue. */
 static void
 rehash (struct hash *h) 
 {
-  size_t old_bucket_cnt, new_bucket_cnt;
-  struct list *new_buckets, *old_buckets;
+  size_t new_bucket_cnt;
+  struct list *new_buckets;
   size_t i;
 
   ASSERT (h != NULL);
 
-  /* Save old bucket info for later use. */
-  old_buckets = h->buckets;
-  old_bucket_cnt = h->bucket_cnt;
+  if (h->old_buckets != NULL)
+    {
+      migrate_buckets (h, MIGRATE_STEP);
+      return;
+    }
+
+  /* Leave the table alone while it is within bounds. */
+  if (h->elem_cnt <= h->bucket_cnt * MAX_ELEMS_PER_BUCKET
+      && (h->elem_cnt >= h->bucket_cnt * MIN_ELEMS_PER_BUCKET
+          || h->bucket_cnt <= 4))
+    return;
 
   /* Calculate the number of buckets to use now.
      We want one bucket for about every BEST_ELEMS_PER_BUCKET.
      We must have at least four buckets, and the number of
-     buckets must be a power of 2. */
-  new_bucket_cnt = h->elem_cnt / BEST_ELEMS_PER_BUCKET;
-  if (new_bucket_cnt < 4)
-    new_bucket_cnt = 4;
-  while (!is_power_of_2 (new_bucket_cnt))
-    new_bucket_cnt = turn_off_least_1bit (new_bucket_cnt);
+     buckets must be a power of 2.  Rounding up leaves the new
+     table well inside both bounds. */
+  new_bucket_cnt = 4;
+  while (new_bucket_cnt < h->elem_cnt / BEST_ELEMS_PER_BUCKET)
+    new_bucket_cnt *= 2;
 
   /* Don't do anything if the bucket count wouldn't change. */
-  if (new_bucket_cnt == old_bucket_cnt)
+  if (new_bucket_cnt == h->bucket_cnt)
     return;
 
   /* Allocate new buckets and initialize them as empty. */
@@ -387,29 +432,14 @@ rehash (struct hash *h)
   for (i = 0; i < new_bucket_cnt; i++) 
     list_init (&new_buckets[i]);
 
-  /* Install new bucket info. */
+  /* Install new bucket info.  The elements follow a few buckets
+     at a time. */
+  h->old_buckets = h->buckets;
+  h->old_bucket_cnt = h->bucket_cnt;
+  h->migrate_idx = 0;
   h->buckets = new_buckets;
   h->bucket_cnt = new_bucket_cnt;
-
-  /* Move each old element into the appropriate new bucket. */
-  for (i = 0; i < old_bucket_cnt; i++) 
-    {
-      struct list *old_bucket;
-      struct list_elem *elem, *next;
-
-      old_bucket = &old_buckets[i];
-      for (elem = list_begin (old_bucket);
-           elem != list_end (old_bucket); elem = next) 
-        {
-          struct list *new_bucket
-            = find_bucket (h, list_elem_to_hash_elem (elem));
-          next = list_next (elem);
-          list_remove (elem);
-          list_push_front (new_bucket, elem);
-        }
-    }
-
-  free (old_buckets);
+  migrate_buckets (h, MIGRATE_STEP);
 }
 
 /* Inserts E into BUCKET (in hash table H). */
@@ -428,3 +458,163 @@ remove_elem (struct hash *h, struct hash_elem *e)
   list_remove (&e->list_elem);
 }
 
+/* Open-addressing table. */
+
+/* Smallest number of slots in a struct ihash. */
+#define IHASH_MIN_SLOTS 8
+
+/* Returns the home slot of KEY in a table of SLOT_CNT slots. */
+static inline size_t
+ihash_home (unsigned key, size_t slot_cnt)
+{
+  /* Fibonacci hashing spreads nearby keys apart. */
+  return (key * 2654435769u) & (slot_cnt - 1);
+}
+
+/* Puts KEY and VALUE into the first free slot from KEY's home
+   slot in SLOTS, which has SLOT_CNT slots and no entry for KEY. */
+static void
+ihash_place (struct ihash_slot *slots, size_t slot_cnt,
+             unsigned key, void *value)
+{
+  size_t i = ihash_home (key, slot_cnt);
+
+  while (slots[i].value != NULL)
+    i = (i + 1) & (slot_cnt - 1);
+  slots[i].key = key;
+  slots[i].value = value;
+}
+
+/* Moves the entries of H into a new array of SLOT_CNT slots.
+   Returns false if memory is not available. */
+static bool
+ihash_resize (struct ihash *h, size_t slot_cnt)
+{
+  struct ihash_slot *slots = calloc (slot_cnt, sizeof *slots);
+  size_t i;
+
+  if (slots == NULL)
+    return false;
+  for (i = 0; i < h->slot_cnt; i++)
+    if (h->slots[i].value != NULL)
+      ihash_place (slots, slot_cnt, h->slots[i].key, h->slots[i].value);
+
+  free (h->slots);
+  h->slots = slots;
+  h->slot_cnt = slot_cnt;
+  return true;
+}
+
+/* Returns the index of KEY's slot in H, or H->slot_cnt if KEY is
+   not in H. */
+static size_t
+ihash_lookup (const struct ihash *h, unsigned key)
+{
+  size_t i = ihash_home (key, h->slot_cnt);
+
+  for (; h->slots[i].value != NULL; i = (i + 1) & (h->slot_cnt - 1))
+    if (h->slots[i].key == key)
+      return i;
+  return h->slot_cnt;
+}
+
+/* Initializes H as an empty table.  Returns false if memory is
+   not available. */
+bool
+ihash_init (struct ihash *h)
+{
+  h->elem_cnt = 0;
+  h->slot_cnt = IHASH_MIN_SLOTS;
+  h->slots = calloc (h->slot_cnt, sizeof *h->slots);
+  return h->slots != NULL;
+}
+
+/* Frees the memory used by H, but not the values in it. */
+void
+ihash_destroy (struct ihash *h)
+{
+  free (h->slots);
+  h->slots = NULL;
+}
+
+/* Maps KEY to VALUE, which must not be null, in H, replacing any
+   earlier value for KEY.  Returns false if the table needed to
+   grow and memory was not available. */
+bool
+ihash_insert (struct ihash *h, unsigned key, void *value)
+{
+  size_t i;
+
+  ASSERT (value != NULL);
+
+  i = ihash_lookup (h, key);
+  if (i < h->slot_cnt)
+    {
+      h->slots[i].value = value;
+      return true;
+    }
+
+  /* Keep the table at most 3/4 full. */
+  if ((h->elem_cnt + 1) * 4 > h->slot_cnt * 3
+      && !ihash_resize (h, h->slot_cnt * 2))
+    return false;
+
+  ihash_place (h->slots, h->slot_cnt, key, value);
+  h->elem_cnt++;
+  return true;
+}
+
+/* Returns the value for KEY in H, or a null pointer if there is
+   none. */
+void *
+ihash_find (const struct ihash *h, unsigned key)
+{
+  size_t i = ihash_lookup (h, key);
+  return i < h->slot_cnt ? h->slots[i].value : NULL;
+}
+
+/* Removes KEY from H and returns its value, or a null pointer if
+   KEY was not in H. */
+void *
+ihash_delete (struct ihash *h, unsigned key)
+{
+  size_t i = ihash_lookup (h, key);
+  size_t mask = h->slot_cnt - 1;
+  size_t j;
+  void *value;
+
+  if (i == h->slot_cnt)
+    return NULL;
+  value = h->slots[i].value;
+  h->slots[i].value = NULL;
+  h->elem_cnt--;
+
+  /* Shift later entries of the probe run back into the hole, so
+     that lookups never stop short of them. */
+  for (j = (i + 1) & mask; h->slots[j].value != NULL; j = (j + 1) & mask)
+    {
+      size_t home = ihash_home (h->slots[j].key, h->slot_cnt);
+
+      /* Move J into I unless J's home lies cyclically in (I, J]. */
+      if (((j - home) & mask) >= ((j - i) & mask))
+        {
+          h->slots[i] = h->slots[j];
+          h->slots[j].value = NULL;
+          i = j;
+        }
+    }
+
+  /* Shrink a table that has become mostly empty.  Failure just
+     leaves it larger than needed. */
+  if (h->slot_cnt > IHASH_MIN_SLOTS && h->elem_cnt * 8 < h->slot_cnt)
+    ihash_resize (h, h->slot_cnt / 2);
+
+  return value;
+}
+
+/* Returns the number of entries in H. */
+size_t
+ihash_size (const struct ihash *h)
+{
+  return h->elem_cnt;
+}
@@ -18,7 +18,18 @@
    conversion from a struct hash_elem back to a structure object
    that contains it.  This is the same technique used in the
    linked list implementation.  Refer to lib/kernel/list.h for a
-   detailed explanation. */
+   detailed explanation.
+
+   The table is resized incrementally.  When it grows or shrinks,
+   a new bucket array is allocated, but elements are moved over
+   from the old one only a couple of buckets at a time, by each
+   later insertion or deletion.  Until the move is done, lookups
+   check whichever array holds the element's bucket.  No single
+   operation has to touch every element.
+
+   For small tables keyed by an integer, struct ihash below is an
+   open-addressing alternative that needs no embedded element
+   and keeps its entries in one array. */
 
 #include <stdbool.h>
 #include <stddef.h>
@@ -61,6 +72,9 @@ struct hash
     size_t elem_cnt;            /* Number of elements in table. */
     size_t bucket_cnt;          /* Number of buckets, a power of 2. */
     struct list *buckets;       /* Array of `bucket_cnt' lists. */
+    struct list *old_buckets;   /* Buckets being emptied, or null. */
+    size_t old_bucket_cnt;      /* Number of old buckets, a power of 2. */
+    size_t migrate_idx;         /* Old buckets below this are empty. */
     hash_hash_func *hash;       /* Hash function. */
     hash_less_func *less;       /* Comparison function. */
     void *aux;                  /* Auxiliary data for `hash' and `less'. */
@@ -100,4 +114,29 @@ unsigned hash_bytes (const void *, size_t);
 unsigned hash_string (const char *);
 unsigned hash_int (int);
 
+/* Open-addressing hash table from unsigned keys to non-null
+   pointers, using linear probing.  Entries live in one
+   array, so lookups touch few cache lines; the array is
+   reallocated at once when it grows or shrinks, which is cheap
+   for the small tables this is meant for. */
+struct ihash_slot
+  {
+    unsigned key;               /* Key. */
+    void *value;                /* Value, or null if the slot is empty. */
+  };
+
+struct ihash
+  {
+    size_t elem_cnt;            /* Number of entries. */
+    size_t slot_cnt;            /* Number of slots, a power of 2. */
+    struct ihash_slot *slots;   /* Array of `slot_cnt' slots. */
+  };
+
+bool ihash_init (struct ihash *);
+void ihash_destroy (struct ihash *);
+bool ihash_insert (struct ihash *, unsigned key, void *value);
+void *ihash_find (const struct ihash *, unsigned key);
+void *ihash_delete (struct ihash *, unsigned key);
+size_t ihash_size (const struct ihash *);
+
 #endif /* lib/kernel/hash.h */
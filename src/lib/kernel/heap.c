@@ -0,0 +1,184 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* Pairing heap.  See heap.h for basic information.
+
+   The root has no siblings and a null PREV.  Every other element
+   has PREV pointing to its parent if it is the first child, or
+   to its previous sibling otherwise, which lets an element be
+   unlinked in O(1). */
+
+/* Melds the heaps rooted at A and B, either of which may be null,
+   and returns the new root.  The greater root becomes the first
+   child of the lesser. */
+static struct heap_elem *
+meld (struct heap *h, struct heap_elem *a, struct heap_elem *b)
+{
+  if (a == NULL)
+    return b;
+  if (b == NULL)
+    return a;
+  if (h->less (b, a, h->aux))
+    {
+      struct heap_elem *t = a;
+      a = b;
+      b = t;
+    }
+
+  b->prev = a;
+  b->next = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  a->child = b;
+  return a;
+}
+
+/* Melds the list of siblings starting at FIRST into one heap,
+   with the standard two-pass pairing, and returns its root. */
+static struct heap_elem *
+merge_pairs (struct heap *h, struct heap_elem *first)
+{
+  struct heap_elem *pairs = NULL, *root = NULL;
+
+  /* First pass: meld pairs left to right, stacking the results
+     on their NEXT members. */
+  while (first != NULL)
+    {
+      struct heap_elem *a = first, *b = first->next, *m;
+
+      first = b != NULL ? b->next : NULL;
+      a->next = a->prev = NULL;
+      if (b != NULL)
+        b->next = b->prev = NULL;
+
+      m = meld (h, a, b);
+      m->next = pairs;
+      pairs = m;
+    }
+
+  /* Second pass: meld right to left. */
+  while (pairs != NULL)
+    {
+      struct heap_elem *next = pairs->next;
+      pairs->next = NULL;
+      root = meld (h, pairs, root);
+      pairs = next;
+    }
+  return root;
+}
+
+/* Unlinks non-root element E, with its subtree, from its parent
+   and siblings. */
+static void
+detach (struct heap_elem *e)
+{
+  if (e->prev->child == e)
+    e->prev->child = e->next;
+  else
+    e->prev->next = e->next;
+  if (e->next != NULL)
+    e->next->prev = e->prev;
+  e->next = e->prev = NULL;
+}
+
+/* Initializes H as an empty heap ordered by LESS, given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux)
+{
+  ASSERT (h != NULL);
+  ASSERT (less != NULL);
+
+  h->root = NULL;
+  h->elem_cnt = 0;
+  h->less = less;
+  h->aux = aux;
+}
+
+/* Inserts E into H. */
+void
+heap_push (struct heap *h, struct heap_elem *e)
+{
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+
+  e->child = e->next = e->prev = NULL;
+  h->root = meld (h, h->root, e);
+  h->elem_cnt++;
+}
+
+/* Returns the least element in H, or a null pointer if H is
+   empty.  Of several equal least elements, any may be returned. */
+struct heap_elem *
+heap_top (const struct heap *h)
+{
+  ASSERT (h != NULL);
+
+  return h->root;
+}
+
+/* Removes and returns the least element in H.  H must not be
+   empty. */
+struct heap_elem *
+heap_pop (struct heap *h)
+{
+  struct heap_elem *top = heap_top (h);
+
+  ASSERT (top != NULL);
+  heap_remove (h, top);
+  return top;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e)
+{
+  struct heap_elem *children;
+
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+  ASSERT (h->elem_cnt > 0);
+
+  children = merge_pairs (h, e->child);
+  if (h->root == e)
+    h->root = children;
+  else
+    {
+      detach (e);
+      h->root = meld (h, h->root, children);
+    }
+  e->child = NULL;
+  h->elem_cnt--;
+}
+
+/* Restores the heap order of H after the key of E, which must be
+   in H, has decreased (moved toward the top).  To handle a key
+   that increased, heap_remove() and heap_push() the element
+   instead. */
+void
+heap_promote (struct heap *h, struct heap_elem *e)
+{
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+
+  if (h->root == e)
+    return;
+  detach (e);
+  h->root = meld (h, h->root, e);
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size (const struct heap *h)
+{
+  ASSERT (h != NULL);
+
+  return h->elem_cnt;
+}
+
+/* Returns true if H is empty, false otherwise. */
+bool
+heap_empty (const struct heap *h)
+{
+  return heap_size (h) == 0;
+}
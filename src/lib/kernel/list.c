@@ -440,8 +440,10 @@ list_sort (struct list *list, list_less_func *less, void *aux)
 }
 
 /* Inserts ELEM in the proper position in LIST, which must be
-   sorted according to LESS given auxiliary data AUX.
-   Runs in O(n) average case in the number of elements in LIST. */
+   sorted according to LESS given auxiliary data AUX.  ELEM goes
+   after any elements equal to it.
+   Runs in O(n) average case in the number of elements in LIST,
+   but in O(1) time if ELEM belongs at the end. */
 void
 list_insert_ordered (struct list *list, struct list_elem *elem,
                      list_less_func *less, void *aux)
@@ -452,12 +454,50 @@ list_insert_ordered (struct list *list, struct list_elem *elem,
   ASSERT (elem != NULL);
   ASSERT (less != NULL);
 
+  if (list_empty (list) || !less (elem, list_back (list), aux))
+    return list_push_back (list, elem);
+
   for (e = list_begin (list); e != list_end (list); e = list_next (e))
     if (less (elem, e, aux))
       break;
   return list_insert (e, elem);
 }
 
+/* Moves ELEM to its proper position in its list, which must be
+   sorted according to LESS given auxiliary data AUX except for
+   ELEM itself, typically because ELEM's value just changed.
+   ELEM ends up after any elements equal to it, as with
+   list_insert_ordered().
+   Runs in time proportional to the distance ELEM moves, and in
+   O(1) time if ELEM is already in place. */
+void
+list_reposition (struct list_elem *elem, list_less_func *less, void *aux)
+{
+  struct list_elem *e;
+
+  ASSERT (is_interior (elem));
+  ASSERT (less != NULL);
+
+  /* Move toward the front past greater elements... */
+  for (e = elem->prev; !is_head (e) && less (elem, e, aux); e = e->prev)
+    continue;
+  if (e != elem->prev)
+    {
+      list_remove (elem);
+      list_insert (e->next, elem);
+      return;
+    }
+
+  /* ...or toward the back past lesser and equal ones. */
+  for (e = elem->next; !is_tail (e) && !less (elem, e, aux); e = e->next)
+    continue;
+  if (e != elem->next)
+    {
+      list_remove (elem);
+      list_insert (e, elem);
+    }
+}
+
 /* Iterates through LIST and removes all but the first in each
    set of adjacent elements that are equal according to LESS
    given auxiliary data AUX.  If DUPLICATES is non-null, then the
@@ -0,0 +1,387 @@
+#include "rbtree.h"
+#include "../debug.h"
+
+/* Red-black tree.  See rbtree.h for basic information.
+
+   The algorithms are those of Cormen, Leiserson, Rivest and
+   Stein, "Introduction to Algorithms", chapter 13, with null
+   pointers in place of the sentinel leaf.  Null children count
+   as black. */
+
+/* Returns true if E is a red node, false if it is black or
+   null. */
+static inline bool
+is_red (const struct rb_elem *e)
+{
+  return e != NULL && e->red;
+}
+
+/* Makes NEW take OLD's place as the child of PARENT, or as the
+   root of T if PARENT is null. */
+static void
+replace_child (struct rbtree *t, struct rb_elem *parent,
+               struct rb_elem *old, struct rb_elem *new)
+{
+  if (parent == NULL)
+    t->root = new;
+  else if (parent->left == old)
+    parent->left = new;
+  else
+    parent->right = new;
+}
+
+/* Rotates X's right child up into X's place. */
+static void
+rotate_left (struct rbtree *t, struct rb_elem *x)
+{
+  struct rb_elem *y = x->right;
+
+  x->right = y->left;
+  if (y->left != NULL)
+    y->left->parent = x;
+  y->parent = x->parent;
+  replace_child (t, x->parent, x, y);
+  y->left = x;
+  x->parent = y;
+}
+
+/* Rotates X's left child up into X's place. */
+static void
+rotate_right (struct rbtree *t, struct rb_elem *x)
+{
+  struct rb_elem *y = x->left;
+
+  x->left = y->right;
+  if (y->right != NULL)
+    y->right->parent = x;
+  y->parent = x->parent;
+  replace_child (t, x->parent, x, y);
+  y->right = x;
+  x->parent = y;
+}
+
+/* Returns the least element in the subtree rooted at E. */
+static struct rb_elem *
+subtree_min (struct rb_elem *e)
+{
+  while (e->left != NULL)
+    e = e->left;
+  return e;
+}
+
+/* Returns the greatest element in the subtree rooted at E. */
+static struct rb_elem *
+subtree_max (struct rb_elem *e)
+{
+  while (e->right != NULL)
+    e = e->right;
+  return e;
+}
+
+/* Initializes T as an empty tree ordered by LESS, given
+   auxiliary data AUX. */
+void
+rb_init (struct rbtree *t, rb_less_func *less, void *aux)
+{
+  ASSERT (t != NULL);
+  ASSERT (less != NULL);
+
+  t->root = NULL;
+  t->elem_cnt = 0;
+  t->less = less;
+  t->aux = aux;
+}
+
+/* Inserts E into T, after any elements equal to it. */
+void
+rb_insert (struct rbtree *t, struct rb_elem *e)
+{
+  struct rb_elem **link = &t->root;
+  struct rb_elem *parent = NULL;
+
+  ASSERT (t != NULL);
+  ASSERT (e != NULL);
+
+  while (*link != NULL)
+    {
+      parent = *link;
+      link = t->less (e, parent, t->aux) ? &parent->left : &parent->right;
+    }
+  e->parent = parent;
+  e->left = e->right = NULL;
+  e->red = true;
+  *link = e;
+  t->elem_cnt++;
+
+  /* Fix up a red node with a red parent. */
+  while (is_red (e->parent))
+    {
+      struct rb_elem *p = e->parent;
+      struct rb_elem *g = p->parent;      /* Exists: the root is black. */
+
+      if (p == g->left)
+        {
+          struct rb_elem *u = g->right;
+          if (is_red (u))
+            {
+              p->red = u->red = false;
+              g->red = true;
+              e = g;
+              continue;
+            }
+          if (e == p->right)
+            {
+              rotate_left (t, p);
+              e = p;
+              p = e->parent;
+            }
+          p->red = false;
+          g->red = true;
+          rotate_right (t, g);
+        }
+      else
+        {
+          struct rb_elem *u = g->left;
+          if (is_red (u))
+            {
+              p->red = u->red = false;
+              g->red = true;
+              e = g;
+              continue;
+            }
+          if (e == p->left)
+            {
+              rotate_right (t, p);
+              e = p;
+              p = e->parent;
+            }
+          p->red = false;
+          g->red = true;
+          rotate_left (t, g);
+        }
+    }
+  t->root->red = false;
+}
+
+/* Puts V, which may be null, in U's place in T. */
+static void
+transplant (struct rbtree *t, struct rb_elem *u, struct rb_elem *v)
+{
+  replace_child (t, u->parent, u, v);
+  if (v != NULL)
+    v->parent = u->parent;
+}
+
+/* Restores the red-black properties of T after a black node was
+   removed from above X, whose parent is PARENT.  X may be
+   null. */
+static void
+remove_fixup (struct rbtree *t, struct rb_elem *x, struct rb_elem *parent)
+{
+  while (x != t->root && !is_red (x))
+    {
+      if (x == parent->left)
+        {
+          struct rb_elem *w = parent->right;
+          if (is_red (w))
+            {
+              w->red = false;
+              parent->red = true;
+              rotate_left (t, parent);
+              w = parent->right;
+            }
+          if (!is_red (w->left) && !is_red (w->right))
+            {
+              w->red = true;
+              x = parent;
+              parent = x->parent;
+            }
+          else
+            {
+              if (!is_red (w->right))
+                {
+                  w->left->red = false;
+                  w->red = true;
+                  rotate_right (t, w);
+                  w = parent->right;
+                }
+              w->red = parent->red;
+              parent->red = false;
+              w->right->red = false;
+              rotate_left (t, parent);
+              x = t->root;
+            }
+        }
+      else
+        {
+          struct rb_elem *w = parent->left;
+          if (is_red (w))
+            {
+              w->red = false;
+              parent->red = true;
+              rotate_right (t, parent);
+              w = parent->left;
+            }
+          if (!is_red (w->left) && !is_red (w->right))
+            {
+              w->red = true;
+              x = parent;
+              parent = x->parent;
+            }
+          else
+            {
+              if (!is_red (w->left))
+                {
+                  w->right->red = false;
+                  w->red = true;
+                  rotate_left (t, w);
+                  w = parent->left;
+                }
+              w->red = parent->red;
+              parent->red = false;
+              w->left->red = false;
+              rotate_right (t, parent);
+              x = t->root;
+            }
+        }
+    }
+  if (x != NULL)
+    x->red = false;
+}
+
+/* Removes E, which must be in T, from T. */
+void
+rb_remove (struct rbtree *t, struct rb_elem *e)
+{
+  struct rb_elem *x, *x_parent;
+  bool removed_red = e->red;
+
+  ASSERT (t != NULL);
+  ASSERT (e != NULL);
+  ASSERT (t->elem_cnt > 0);
+
+  if (e->left == NULL)
+    {
+      x = e->right;
+      x_parent = e->parent;
+      transplant (t, e, e->right);
+    }
+  else if (e->right == NULL)
+    {
+      x = e->left;
+      x_parent = e->parent;
+      transplant (t, e, e->left);
+    }
+  else
+    {
+      /* Replace E by its successor Y, which has no left child. */
+      struct rb_elem *y = subtree_min (e->right);
+
+      removed_red = y->red;
+      x = y->right;
+      if (y->parent == e)
+        x_parent = y;
+      else
+        {
+          x_parent = y->parent;
+          transplant (t, y, y->right);
+          y->right = e->right;
+          y->right->parent = y;
+        }
+      transplant (t, e, y);
+      y->left = e->left;
+      y->left->parent = y;
+      y->red = e->red;
+    }
+  t->elem_cnt--;
+
+  if (!removed_red)
+    remove_fixup (t, x, x_parent);
+}
+
+/* Returns the first element in T equal to KEY, or a null pointer
+   if there is none. */
+struct rb_elem *
+rb_find (const struct rbtree *t, const struct rb_elem *key)
+{
+  struct rb_elem *e, *found = NULL;
+
+  ASSERT (t != NULL);
+  ASSERT (key != NULL);
+
+  for (e = t->root; e != NULL; )
+    if (t->less (e, key, t->aux))
+      e = e->right;
+    else
+      {
+        /* E >= KEY.  Keep looking left for an earlier equal one. */
+        if (!t->less (key, e, t->aux))
+          found = e;
+        e = e->left;
+      }
+  return found;
+}
+
+/* Returns the least element in T, or a null pointer if T is
+   empty. */
+struct rb_elem *
+rb_first (const struct rbtree *t)
+{
+  ASSERT (t != NULL);
+
+  return t->root != NULL ? subtree_min (t->root) : NULL;
+}
+
+/* Returns the greatest element in T, or a null pointer if T is
+   empty. */
+struct rb_elem *
+rb_last (const struct rbtree *t)
+{
+  ASSERT (t != NULL);
+
+  return t->root != NULL ? subtree_max (t->root) : NULL;
+}
+
+/* Returns the element after E in its tree, or a null pointer if E
+   is the last. */
+struct rb_elem *
+rb_next (struct rb_elem *e)
+{
+  ASSERT (e != NULL);
+
+  if (e->right != NULL)
+    return subtree_min (e->right);
+  while (e->parent != NULL && e == e->parent->right)
+    e = e->parent;
+  return e->parent;
+}
+
+/* Returns the element before E in its tree, or a null pointer if
+   E is the first. */
+struct rb_elem *
+rb_prev (struct rb_elem *e)
+{
+  ASSERT (e != NULL);
+
+  if (e->left != NULL)
+    return subtree_max (e->left);
+  while (e->parent != NULL && e == e->parent->left)
+    e = e->parent;
+  return e->parent;
+}
+
+/* Returns the number of elements in T. */
+size_t
+rb_size (const struct rbtree *t)
+{
+  ASSERT (t != NULL);
+
+  return t->elem_cnt;
+}
+
+/* Returns true if T is empty, false otherwise. */
+bool
+rb_empty (const struct rbtree *t)
+{
+  return rb_size (t) == 0;
+}
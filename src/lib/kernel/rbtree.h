@@ -0,0 +1,86 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+
+   A binary search tree that keeps itself balanced, so that
+   insertion, removal and search are all O(log n) and the least
+   and greatest elements can be found without a linear scan.
+   Equal elements are allowed; an element is inserted after any
+   elements equal to it, so a tree used as a priority queue is
+   first-in, first-out among equals.
+
+   Like lists and hash tables, trees do not allocate memory.  Each
+   structure that can be in a tree embeds a struct rb_elem
+   member, and rb_entry() converts a struct rb_elem back into the
+   structure that contains it, as list_entry() does; see
+   lib/kernel/list.h for a detailed explanation.
+
+   Iteration idiom, in ascending order:
+
+      struct rb_elem *e;
+
+      for (e = rb_first (&tree); e != NULL; e = rb_next (e))
+        {
+          struct foo *f = rb_entry (e, struct foo, elem);
+          ...do something with f...
+        }
+
+   Removing the current element during iteration is allowed as
+   long as rb_next() was called on it first. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Tree element. */
+struct rb_elem 
+  {
+    struct rb_elem *parent;     /* Parent, or null for the root. */
+    struct rb_elem *left;       /* Left (lesser) child. */
+    struct rb_elem *right;      /* Right (greater or equal) child. */
+    bool red;                   /* Red or black node. */
+  };
+
+/* Converts pointer to tree element RB_ELEM into a pointer to
+   the structure that RB_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the tree element. */
+#define rb_entry(RB_ELEM, STRUCT, MEMBER)               \
+        ((STRUCT *) ((uint8_t *) &(RB_ELEM)->parent     \
+                     - offsetof (STRUCT, MEMBER.parent)))
+
+/* Compares the value of two tree elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_elem *a,
+                           const struct rb_elem *b,
+                           void *aux);
+
+/* Red-black tree. */
+struct rbtree 
+  {
+    struct rb_elem *root;       /* Root, or null if empty. */
+    size_t elem_cnt;            /* Number of elements. */
+    rb_less_func *less;         /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void rb_init (struct rbtree *, rb_less_func *, void *aux);
+
+/* Insertion, deletion, search. */
+void rb_insert (struct rbtree *, struct rb_elem *);
+void rb_remove (struct rbtree *, struct rb_elem *);
+struct rb_elem *rb_find (const struct rbtree *, const struct rb_elem *);
+
+/* Traversal. */
+struct rb_elem *rb_first (const struct rbtree *);
+struct rb_elem *rb_last (const struct rbtree *);
+struct rb_elem *rb_next (struct rb_elem *);
+struct rb_elem *rb_prev (struct rb_elem *);
+
+/* Information. */
+size_t rb_size (const struct rbtree *);
+bool rb_empty (const struct rbtree *);
+
+#endif /* lib/kernel/rbtree.h */
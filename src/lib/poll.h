@@ -0,0 +1,26 @@
+#ifndef __LIB_POLL_H
+#define __LIB_POLL_H
+
+/* Arguments of the poll() system call.  Shared by the kernel and
+   user programs. */
+
+/* Most descriptors one poll() call watches. */
+#define POLL_MAX 64
+
+/* Events.  POLLERR, POLLHUP and POLLNVAL are reported whether or
+   not they are asked for. */
+#define POLLIN 0x01             /* Data can be read without waiting. */
+#define POLLOUT 0x04            /* Data can be written without waiting. */
+#define POLLERR 0x08            /* Writing would fail: no reader left. */
+#define POLLHUP 0x10            /* No writer left. */
+#define POLLNVAL 0x20           /* FD is not open. */
+
+/* A descriptor to watch. */
+struct pollfd
+  {
+    int fd;                     /* Descriptor, ignored if negative. */
+    short events;               /* Events of interest. */
+    short revents;              /* Events that occurred. */
+  };
+
+#endif /* lib/poll.h */
@@ -0,0 +1,14 @@
+#ifndef __LIB_SCHED_H
+#define __LIB_SCHED_H
+
+/* Scheduling classes.  Shared by the kernel and user programs,
+   which select a class with the sched_setclass() system call. */
+enum sched_class
+  {
+    SCHED_RR,                   /* Round-robin, per-thread quantum. */
+    SCHED_FIFO,                 /* Real-time, runs until it blocks or yields. */
+    SCHED_BATCH,                /* Throughput, long slices, rarely preempted. */
+    SCHED_CLASS_CNT             /* Number of scheduling classes. */
+  };
+
+#endif /* lib/sched.h */
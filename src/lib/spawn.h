@@ -0,0 +1,36 @@
+#ifndef __LIB_SPAWN_H
+#define __LIB_SPAWN_H
+
+/* Arguments of the spawn() system call.  Shared by the kernel and
+   user programs. */
+
+/* Most children one spawn() call starts. */
+#define SPAWN_MAX 1024
+
+/* Most argument plus environment strings a new process can get. */
+#define SPAWN_ARG_MAX 64
+
+/* Most descriptors one spawn() call passes. */
+#define SPAWN_FD_MAX 16
+
+/* Gives the child its own open file for the parent's PARENT_FD,
+   as CHILD_FD.  Descriptors 0 and 1 are always the console, so
+   CHILD_FD must be 2 or more. */
+struct spawn_fd
+  {
+    int parent_fd;              /* Descriptor in the parent. */
+    int child_fd;               /* Descriptor in the child. */
+  };
+
+/* What to run.  Every child started by one spawn() call gets the
+   same program, arguments, environment and descriptors. */
+struct spawn_args
+  {
+    const char *file;           /* Executable, or NULL for argv[0]. */
+    char *const *argv;          /* Null-terminated argument vector. */
+    char *const *envp;          /* Null-terminated environment, or NULL. */
+    const struct spawn_fd *fds; /* Descriptors to pass, or NULL. */
+    int fd_cnt;                 /* Number of elements in FDS. */
+  };
+
+#endif /* lib/spawn.h */
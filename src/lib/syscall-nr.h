@@ -28,7 +28,36 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Scheduling. */
+    SYS_SCHED_SETCLASS,         /* Change the scheduling class. */
+    SYS_SCHED_GETCLASS,         /* Report the scheduling class. */
+
+    /* User synchronization. */
+    SYS_FUTEX_WAIT,             /* Sleep while a word holds a value. */
+    SYS_FUTEX_WAKE,             /* Wake threads sleeping on a word. */
+
+    /* User threads. */
+    SYS_UTHREAD_CREATE,         /* Start a thread in this process. */
+    SYS_UTHREAD_JOIN,           /* Wait for a thread to exit. */
+    SYS_UTHREAD_EXIT,           /* Terminate this thread. */
+
+    /* Process creation. */
+    SYS_SPAWN,                  /* Start several processes at once. */
+    SYS_FORK,                   /* Duplicate this process. */
+    SYS_WAITPID,                /* Wait for a child, or any child, to die. */
+
+    /* Interprocess communication. */
+    SYS_PIPE,                   /* Create a pipe. */
+    SYS_POLL,                   /* Wait for descriptors to become ready. */
+    SYS_CONSOLE_MODE,           /* Set the console input mode. */
+    SYS_SHM_MAP,                /* Map a shared memory segment. */
+    SYS_SHM_UNMAP,              /* Unmap a shared memory segment. */
+    SYS_SHM_UNLINK,             /* Remove a shared memory segment's name. */
+
+    /* Debugging. */
+    SYS_MEMPROF                 /* Print the kernel memory profile. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -1,10 +1,13 @@
 #include <syscall.h>
 
 int main (int, char *[]);
-void _start (int argc, char *argv[]);
+void _start (int argc, char *argv[], char *envp[]);
+
+char **environ;
 
 void
-_start (int argc, char *argv[]) 
+_start (int argc, char *argv[], char *envp[]) 
 {
+  environ = envp;
   exit (main (argc, argv));
 }
@@ -0,0 +1,117 @@
+#include <synch.h>
+#include <limits.h>
+#include <syscall.h>
+
+/* Atomically stores NEW in *P if it holds OLD.  Returns the value
+   *P held before. */
+static inline int
+atomic_cmpxchg (int *p, int old, int new)
+{
+  int prev;
+  asm volatile ("lock cmpxchgl %2, %1"
+                : "=a" (prev), "+m" (*p)
+                : "r" (new), "0" (old)
+                : "memory");
+  return prev;
+}
+
+/* Atomically stores NEW in *P and returns the previous value. */
+static inline int
+atomic_xchg (int *p, int new)
+{
+  asm volatile ("xchgl %0, %1"
+                : "+r" (new), "+m" (*p)
+                :
+                : "memory");
+  return new;
+}
+
+/* Atomically adds 1 to *P. */
+static inline void
+atomic_inc (int *p)
+{
+  asm volatile ("lock incl %0" : "+m" (*p) : : "memory");
+}
+
+/* Initializes M as unlocked. */
+void
+mutex_init (struct mutex *m)
+{
+  m->value = 0;
+}
+
+/* Acquires M, sleeping in the kernel only if it is contended. */
+void
+mutex_lock (struct mutex *m)
+{
+  int c = atomic_cmpxchg (&m->value, 0, 1);
+  if (c == 0)
+    return;
+
+  /* Mark M contended, then sleep until we are the one to take it
+     from unlocked.  We leave it marked contended, since others
+     may still be sleeping. */
+  if (c != 2)
+    c = atomic_xchg (&m->value, 2);
+  while (c != 0)
+    {
+      futex_wait (&m->value, 2);
+      c = atomic_xchg (&m->value, 2);
+    }
+}
+
+/* Acquires M if it is unlocked.  Returns nonzero on success. */
+int
+mutex_trylock (struct mutex *m)
+{
+  return atomic_cmpxchg (&m->value, 0, 1) == 0;
+}
+
+/* Releases M, entering the kernel only if someone may be
+   sleeping on it. */
+void
+mutex_unlock (struct mutex *m)
+{
+  if (atomic_xchg (&m->value, 0) == 2)
+    futex_wake (&m->value, 1);
+}
+
+/* Initializes CV. */
+void
+condvar_init (struct condvar *cv)
+{
+  cv->seq = 0;
+}
+
+/* Atomically releases M and waits for CV to be signaled, then
+   reacquires M.  As with any condition variable, the caller must
+   recheck its condition afterward. */
+void
+condvar_wait (struct condvar *cv, struct mutex *m)
+{
+  int seq = cv->seq;
+
+  mutex_unlock (m);
+  futex_wait (&cv->seq, seq);
+
+  /* Other waiters may have been woken with us, so take M as
+     contended to make sure its release wakes them. */
+  while (atomic_xchg (&m->value, 2) != 0)
+    futex_wait (&m->value, 2);
+}
+
+/* Wakes one thread waiting on CV, if any. */
+void
+condvar_signal (struct condvar *cv)
+{
+  atomic_inc (&cv->seq);
+  futex_wake (&cv->seq, 1);
+}
+
+/* Wakes all threads waiting on CV. */
+void
+condvar_broadcast (struct condvar *cv)
+{
+  atomic_inc (&cv->seq);
+  futex_wake (&cv->seq, INT_MAX);
+}
@@ -0,0 +1,35 @@
+#ifndef __LIB_USER_SYNCH_H
+#define __LIB_USER_SYNCH_H
+
+/* User-level mutexes and condition variables built on futexes.
+   Uncontended lock and unlock never enter the kernel. */
+
+/* Mutex.  VALUE is 0 if unlocked, 1 if locked, 2 if locked and
+   another thread may be sleeping on it. */
+struct mutex
+  {
+    int value;
+  };
+
+#define MUTEX_INITIALIZER { 0 }
+
+void mutex_init (struct mutex *);
+void mutex_lock (struct mutex *);
+int mutex_trylock (struct mutex *);
+void mutex_unlock (struct mutex *);
+
+/* Condition variable.  SEQ changes on every signal, so a waiter
+   that raced with a signal does not go to sleep. */
+struct condvar
+  {
+    int seq;
+  };
+
+#define CONDVAR_INITIALIZER { 0 }
+
+void condvar_init (struct condvar *);
+void condvar_wait (struct condvar *, struct mutex *);
+void condvar_signal (struct condvar *);
+void condvar_broadcast (struct condvar *);
+
+#endif /* lib/user/synch.h */
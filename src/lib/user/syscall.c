@@ -182,3 +182,121 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+bool
+sched_setclass (int class, int time_slice)
+{
+  return syscall2 (SYS_SCHED_SETCLASS, class, time_slice);
+}
+
+int
+sched_getclass (void)
+{
+  return syscall0 (SYS_SCHED_GETCLASS);
+}
+
+int
+futex_wait (int *addr, int val)
+{
+  return syscall2 (SYS_FUTEX_WAIT, addr, val);
+}
+
+int
+futex_wake (int *addr, int cnt)
+{
+  return syscall2 (SYS_FUTEX_WAKE, addr, cnt);
+}
+
+/* Where threads made by uthread_create() begin.  Returning from
+   FUNC ends the thread. */
+static void
+uthread_start (void (*func) (void *), void *arg)
+{
+  func (arg);
+  uthread_exit (0);
+}
+
+int
+uthread_create (void (*func) (void *), void *arg)
+{
+  return syscall3 (SYS_UTHREAD_CREATE, uthread_start, func, arg);
+}
+
+int
+uthread_join (int tid)
+{
+  return syscall1 (SYS_UTHREAD_JOIN, tid);
+}
+
+void
+uthread_exit (int status)
+{
+  syscall1 (SYS_UTHREAD_EXIT, status);
+  NOT_REACHED ();
+}
+
+int
+spawn (const struct spawn_args *args, int n, pid_t pids[])
+{
+  return syscall3 (SYS_SPAWN, args, n, pids);
+}
+
+pid_t
+fork (void)
+{
+  return syscall0 (SYS_FORK);
+}
+
+pid_t
+waitpid (pid_t pid, int *status, int options)
+{
+  return syscall3 (SYS_WAITPID, pid, status, options);
+}
+
+pid_t
+wait_any (int *status)
+{
+  return waitpid (-1, status, 0);
+}
+
+int
+pipe (int fds[2])
+{
+  return syscall1 (SYS_PIPE, fds);
+}
+
+int
+poll (struct pollfd *fds, int nfds, int timeout)
+{
+  return syscall3 (SYS_POLL, fds, nfds, timeout);
+}
+
+int
+console_mode (int mode)
+{
+  return syscall1 (SYS_CONSOLE_MODE, mode);
+}
+
+void *
+shm_map (const char *name, size_t size)
+{
+  return (void *) syscall2 (SYS_SHM_MAP, name, size);
+}
+
+bool
+shm_unmap (void *addr)
+{
+  return syscall1 (SYS_SHM_UNMAP, addr);
+}
+
+bool
+shm_unlink (const char *name)
+{
+  return syscall1 (SYS_SHM_UNLINK, name);
+}
+
+void
+memprof (void)
+{
+  syscall0 (SYS_MEMPROF);
+}
@@ -2,7 +2,11 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <debug.h>
+#include <poll.h>
+#include <sched.h>
+#include <spawn.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -15,6 +19,16 @@ typedef int mapid_t;
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
+/* Maximum characters in the name of a shared memory segment. */
+#define SHM_NAME_MAX 14
+
+/* Console input modes, for console_mode(). */
+#define CONSOLE_CANONICAL 0     /* Read whole lines, with editing. */
+#define CONSOLE_RAW 1           /* Read keys as they arrive. */
+
+/* Options for waitpid(). */
+#define WNOHANG 1               /* Return 0 if no child has died yet. */
+
 /* Typical return values from main() and arguments to exit(). */
 #define EXIT_SUCCESS 0          /* Successful execution. */
 #define EXIT_FAILURE 1          /* Unsuccessful execution. */
@@ -45,4 +59,78 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Scheduling. */
+bool sched_setclass (int class, int time_slice);
+int sched_getclass (void);
+
+/* User synchronization. */
+int futex_wait (int *addr, int val);
+int futex_wake (int *addr, int cnt);
+
+/* User threads.  They share the address space, open files and
+   working directory of the process.  exit() in any of them ends
+   the whole process. */
+int uthread_create (void (*func) (void *), void *arg);
+int uthread_join (int tid);
+void uthread_exit (int status) NO_RETURN;
+
+/* Process creation.  Starts N copies of the program described by
+   ARGS, storing each child's pid, or PID_ERROR, in PIDS[].  Returns
+   the number of children started, or -1 if ARGS is invalid. */
+int spawn (const struct spawn_args *args, int n, pid_t pids[]);
+
+/* Starts a copy of this process that shares its memory
+   copy-on-write and has the same descriptors open.  Returns the
+   child's pid in the parent, 0 in the child, or PID_ERROR. */
+pid_t fork (void);
+
+/* Waits for child PID to die, or for any child process if PID is
+   -1, and stores its exit status in *STATUS unless STATUS is
+   null.  Returns the child's pid, 0 with WNOHANG if no such child
+   has died yet, or PID_ERROR.  wait_any() waits for any child. */
+pid_t waitpid (pid_t pid, int *status, int options);
+pid_t wait_any (int *status);
+
+/* Interprocess communication.  Creates a pipe and stores
+   descriptors for its read end in FDS[0] and its write end in
+   FDS[1].  Both ends are inherited by fork() and can be passed
+   by spawn().  Reads wait for data and return 0 once every write
+   end is closed; writes wait for room and fail once every read
+   end is closed.  Whole, page-aligned pages are moved between
+   processes without copying.  Returns 0, or -1 on failure. */
+int pipe (int fds[2]);
+
+/* Waits until one of the NFDS descriptors in FDS is ready for the
+   events asked for, for at most TIMEOUT milliseconds, or for good
+   if TIMEOUT is negative.  Watches the console, pipes and files,
+   which are always ready.  Sets each revents and returns the
+   number of descriptors with events, 0 on timeout, or -1 on
+   error. */
+int poll (struct pollfd *fds, int nfds, int timeout);
+
+/* Sets the console input mode to CONSOLE_CANONICAL or CONSOLE_RAW
+   and returns the old one, or -1 if MODE is invalid.  read() on
+   fd 0 returns whatever input is available, waiting only if there
+   is none; in canonical mode that is at most one line, and 0 after
+   Ctrl+D on an empty line. */
+int console_mode (int mode);
+
+/* Shared memory.  shm_map() maps the segment called NAME and
+   returns its address, first creating it, zeroed, if it does not
+   exist and SIZE is nonzero.  Every process that maps a segment
+   sees the others' writes, including children after fork().
+   Returns a null pointer on failure.  shm_unmap() unmaps the
+   segment at ADDR.  shm_unlink() removes NAME; the segment is
+   freed once it is also unmapped everywhere. */
+void *shm_map (const char *name, size_t size);
+bool shm_unmap (void *addr);
+bool shm_unlink (const char *name);
+
+/* Environment handed to this process by spawn(), null-terminated. */
+extern char **environ;
+
+/* Debugging.  Prints the kernel's memory profile to the
+   console; does nothing unless the kernel was built with it. */
+void memprof (void);
+
 #endif /* lib/user/syscall.h */
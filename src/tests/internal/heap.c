@@ -0,0 +1,150 @@
+/* Test program for lib/kernel/heap.c.
+
+   Runs a heap through random pushes, pops, removals of arbitrary
+   elements and key decreases, checking each result against a
+   linear scan of the elements that should be in it.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <heap.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Number of elements to work with. */
+#define MAX_SIZE 128
+
+/* A heap element. */
+struct value 
+  {
+    struct heap_elem elem;      /* Heap element. */
+    int value;                  /* Item value. */
+    bool in_heap;               /* Currently in the heap? */
+  };
+
+static bool value_less (const struct heap_elem *, const struct heap_elem *,
+                        void *);
+static struct value *linear_min (struct value[], size_t);
+
+/* Test the heap implementation. */
+void
+test (void) 
+{
+  static struct value values[MAX_SIZE];
+  struct heap heap;
+  size_t size = 0;
+  int round;
+
+  heap_init (&heap, value_less, NULL);
+  ASSERT (heap_empty (&heap));
+  ASSERT (heap_top (&heap) == NULL);
+
+  printf ("testing heap:");
+  for (round = 0; round < 20; round++)
+    {
+      int step;
+
+      printf (" %d", round);
+      for (step = 0; step < MAX_SIZE * 8; step++)
+        {
+          struct value *v = &values[random_ulong () % MAX_SIZE];
+          struct value *min;
+
+          switch (random_ulong () % 4)
+            {
+            case 0:
+              /* Push. */
+              if (!v->in_heap)
+                {
+                  v->value = random_ulong () % 1000;
+                  heap_push (&heap, &v->elem);
+                  v->in_heap = true;
+                  size++;
+                }
+              break;
+
+            case 1:
+              /* Pop. */
+              if (size > 0 && round % 2 == 1)
+                {
+                  min = heap_entry (heap_pop (&heap), struct value, elem);
+                  ASSERT (min->in_heap);
+                  ASSERT (min->value == linear_min (values, MAX_SIZE)->value);
+                  min->in_heap = false;
+                  size--;
+                }
+              break;
+
+            case 2:
+              /* Remove an arbitrary element. */
+              if (v->in_heap)
+                {
+                  heap_remove (&heap, &v->elem);
+                  v->in_heap = false;
+                  size--;
+                }
+              break;
+
+            case 3:
+              /* Decrease a key. */
+              if (v->in_heap)
+                {
+                  v->value -= random_ulong () % 100;
+                  heap_promote (&heap, &v->elem);
+                }
+              break;
+            }
+
+          ASSERT (heap_size (&heap) == size);
+          min = linear_min (values, MAX_SIZE);
+          if (min == NULL)
+            {
+              ASSERT (heap_top (&heap) == NULL);
+            }
+          else
+            {
+              ASSERT (heap_entry (heap_top (&heap), struct value, elem)->value
+                      == min->value);
+            }
+        }
+    }
+
+  /* Drain in order. */
+  while (!heap_empty (&heap))
+    {
+      struct value *min = heap_entry (heap_pop (&heap), struct value, elem);
+      min->in_heap = false;
+      ASSERT (linear_min (values, MAX_SIZE) == NULL
+              || linear_min (values, MAX_SIZE)->value >= min->value);
+    }
+  printf (" done\n");
+}
+
+/* Orders by value. */
+static bool
+value_less (const struct heap_elem *a_, const struct heap_elem *b_,
+            void *aux UNUSED) 
+{
+  const struct value *a = heap_entry (a_, struct value, elem);
+  const struct value *b = heap_entry (b_, struct value, elem);
+  
+  return a->value < b->value;
+}
+
+/* Returns a least-valued element of the CNT in VALUES that are
+   marked in_heap, or a null pointer if none are. */
+static struct value *
+linear_min (struct value values[], size_t cnt)
+{
+  struct value *min = NULL;
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    if (values[i].in_heap && (min == NULL || values[i].value < min->value))
+      min = &values[i];
+  return min;
+}
@@ -0,0 +1,155 @@
+/* Test program for lib/kernel/rbtree.c.
+
+   Inserts and removes random values, checking after each step
+   that the tree is ordered, balanced and in step with a simple
+   array of the values that should be in it.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <random.h>
+#include <rbtree.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Number of elements to work with, and the range of values,
+   small enough that there are many duplicates. */
+#define MAX_SIZE 128
+#define MAX_VALUE 32
+
+/* A tree element. */
+struct value 
+  {
+    struct rb_elem elem;        /* Tree element. */
+    int value;                  /* Item value. */
+    int serial;                 /* Insertion order, to check FIFO ties. */
+    bool in_tree;               /* Currently in the tree? */
+  };
+
+static bool value_less (const struct rb_elem *, const struct rb_elem *,
+                        void *);
+static int verify_subtree (const struct rb_elem *, const struct rb_elem *);
+static void verify_tree (struct rbtree *, struct value[], size_t);
+
+/* Test the red-black tree implementation. */
+void
+test (void) 
+{
+  static struct value values[MAX_SIZE];
+  struct rbtree tree;
+  int serial = 0;
+  int round;
+
+  rb_init (&tree, value_less, NULL);
+  ASSERT (rb_empty (&tree));
+  ASSERT (rb_first (&tree) == NULL && rb_last (&tree) == NULL);
+
+  printf ("testing red-black tree:");
+  for (round = 0; round < 20; round++)
+    {
+      int step;
+
+      printf (" %d", round);
+      for (step = 0; step < MAX_SIZE * 8; step++)
+        {
+          struct value *v = &values[random_ulong () % MAX_SIZE];
+
+          if (!v->in_tree)
+            {
+              v->value = random_ulong () % MAX_VALUE;
+              v->serial = serial++;
+              rb_insert (&tree, &v->elem);
+              v->in_tree = true;
+            }
+          else if (random_ulong () % 3 != 0 || round % 2 == 1)
+            {
+              rb_remove (&tree, &v->elem);
+              v->in_tree = false;
+            }
+          verify_tree (&tree, values, MAX_SIZE);
+        }
+    }
+
+  /* Empty it through rb_next() while removing. */
+  while (!rb_empty (&tree))
+    {
+      struct rb_elem *e = rb_first (&tree);
+      struct rb_elem *next = rb_next (e);
+      rb_remove (&tree, e);
+      rb_entry (e, struct value, elem)->in_tree = false;
+      ASSERT (rb_first (&tree) == next);
+    }
+  verify_tree (&tree, values, MAX_SIZE);
+  printf (" done\n");
+}
+
+/* Orders by value, then by nothing: equal values compare equal. */
+static bool
+value_less (const struct rb_elem *a_, const struct rb_elem *b_,
+            void *aux UNUSED) 
+{
+  const struct value *a = rb_entry (a_, struct value, elem);
+  const struct value *b = rb_entry (b_, struct value, elem);
+  
+  return a->value < b->value;
+}
+
+/* Checks the subtree rooted at E, whose parent is PARENT, and
+   returns its black height. */
+static int
+verify_subtree (const struct rb_elem *e, const struct rb_elem *parent)
+{
+  int left, right;
+
+  if (e == NULL)
+    return 1;
+  ASSERT (e->parent == parent);
+  ASSERT (!e->red || ((e->left == NULL || !e->left->red)
+                      && (e->right == NULL || !e->right->red)));
+  left = verify_subtree (e->left, e);
+  right = verify_subtree (e->right, e);
+  ASSERT (left == right);
+  return left + !e->red;
+}
+
+/* Checks that TREE is a valid red-black tree holding exactly the
+   CNT-element array VALUES' members that are marked in_tree, in
+   order, with equal values in insertion order. */
+static void
+verify_tree (struct rbtree *tree, struct value values[], size_t cnt) 
+{
+  struct rb_elem *e, *prev = NULL;
+  size_t in_tree = 0, seen = 0, i;
+
+  ASSERT (tree->root == NULL || !tree->root->red);
+  verify_subtree (tree->root, NULL);
+
+  for (i = 0; i < cnt; i++)
+    if (values[i].in_tree)
+      in_tree++;
+  ASSERT (rb_size (tree) == in_tree);
+
+  for (e = rb_first (tree); e != NULL; prev = e, e = rb_next (e))
+    {
+      struct value *v = rb_entry (e, struct value, elem);
+
+      ASSERT (v->in_tree);
+      ASSERT (rb_prev (e) == prev);
+      if (prev != NULL)
+        {
+          struct value *p = rb_entry (prev, struct value, elem);
+          ASSERT (p->value < v->value
+                  || (p->value == v->value && p->serial < v->serial));
+        }
+      if (prev == NULL || value_less (prev, e, NULL))
+        {
+          ASSERT (rb_find (tree, e) == e);
+        }
+      seen++;
+    }
+  ASSERT (seen == in_tree);
+  ASSERT (rb_last (tree) == prev);
+}
@@ -0,0 +1,177 @@
+/* Test program and microbenchmark for the block functions in
+   lib/string.c.
+
+   Checks memcpy(), memmove(), memset(), memcmp() and strlen()
+   against simple byte-at-a-time versions over all small
+   alignments and lengths, then times both versions on page-sized
+   blocks and prints the speedup.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/test.h"
+
+/* Largest block checked for correctness, and its alignments. */
+#define MAX_SIZE 80
+#define MAX_ALIGN 8
+
+/* Size of the blocks timed, and how many times to repeat. */
+#define BENCH_SIZE 4096
+#define BENCH_REPS 2000
+
+static unsigned char src[BENCH_SIZE + MAX_ALIGN];
+static unsigned char dst[BENCH_SIZE + MAX_ALIGN];
+static unsigned char ref[BENCH_SIZE + MAX_ALIGN];
+
+static void check_block_functions (void);
+static void bench (const char *name,
+                   void (*fast) (void), void (*slow) (void));
+
+/* Byte-at-a-time reference versions. */
+static void
+byte_copy (unsigned char *d, const unsigned char *s, size_t size)
+{
+  while (size-- > 0)
+    *d++ = *s++;
+}
+
+static void
+byte_set (unsigned char *d, int value, size_t size)
+{
+  while (size-- > 0)
+    *d++ = value;
+}
+
+static int
+byte_compare (const unsigned char *a, const unsigned char *b, size_t size)
+{
+  for (; size-- > 0; a++, b++)
+    if (*a != *b)
+      return *a > *b ? +1 : -1;
+  return 0;
+}
+
+static size_t
+byte_length (const char *s)
+{
+  const char *p;
+  for (p = s; *p != '\0'; p++)
+    continue;
+  return p - s;
+}
+
+/* Benchmark bodies. */
+static void fast_copy (void) { memcpy (dst, src, BENCH_SIZE); }
+static void slow_copy (void) { byte_copy (dst, src, BENCH_SIZE); }
+static void fast_set (void) { memset (dst, 0, BENCH_SIZE); }
+static void slow_set (void) { byte_set (dst, 0, BENCH_SIZE); }
+static void fast_compare (void) { ASSERT (memcmp (dst, ref, BENCH_SIZE) == 0); }
+static void slow_compare (void)
+{
+  ASSERT (byte_compare (dst, ref, BENCH_SIZE) == 0);
+}
+static void fast_length (void) { ASSERT (strlen ((char *) src) > 0); }
+static void slow_length (void) { ASSERT (byte_length ((char *) src) > 0); }
+
+/* Tests and times the block functions. */
+void
+test (void) 
+{
+  printf ("checking block functions...");
+  check_block_functions ();
+  printf (" done\n");
+
+  memset (src, 'x', BENCH_SIZE);
+  src[BENCH_SIZE - 1] = '\0';
+  memset (ref, 0, BENCH_SIZE);
+  bench ("memcpy", fast_copy, slow_copy);
+  bench ("memset", fast_set, slow_set);
+  bench ("memcmp", fast_compare, slow_compare);
+  bench ("strlen", fast_length, slow_length);
+}
+
+/* Checks every combination of source and destination alignment
+   and length up to MAX_SIZE. */
+static void
+check_block_functions (void)
+{
+  size_t s_ofs, d_ofs, size, i;
+
+  for (s_ofs = 0; s_ofs < MAX_ALIGN; s_ofs++)
+    for (d_ofs = 0; d_ofs < MAX_ALIGN; d_ofs++)
+      for (size = 0; size <= MAX_SIZE; size++)
+        {
+          random_bytes (src, sizeof src);
+          random_bytes (dst, sizeof dst);
+          byte_copy (ref, dst, sizeof ref);
+
+          /* memcpy. */
+          ASSERT (memcpy (dst + d_ofs, src + s_ofs, size) == dst + d_ofs);
+          byte_copy (ref + d_ofs, src + s_ofs, size);
+          ASSERT (byte_compare (dst, ref, sizeof dst) == 0);
+
+          /* memset. */
+          ASSERT (memset (dst + d_ofs, s_ofs, size) == dst + d_ofs);
+          byte_set (ref + d_ofs, s_ofs, size);
+          ASSERT (byte_compare (dst, ref, sizeof dst) == 0);
+
+          /* memmove, overlapping in both directions. */
+          ASSERT (memmove (dst + d_ofs, dst + s_ofs, size) == dst + d_ofs);
+          if (d_ofs <= s_ofs)
+            byte_copy (ref + d_ofs, ref + s_ofs, size);
+          else
+            for (i = size; i-- > 0; )
+              ref[d_ofs + i] = ref[s_ofs + i];
+          ASSERT (byte_compare (dst, ref, sizeof dst) == 0);
+
+          /* memcmp, with and without a difference. */
+          ASSERT (memcmp (dst + d_ofs, ref + d_ofs, size) == 0);
+          if (size > 0)
+            {
+              i = d_ofs + random_ulong () % size;
+              ref[i]++;
+              ASSERT (memcmp (dst + d_ofs, ref + d_ofs, size)
+                      == byte_compare (dst + d_ofs, ref + d_ofs, size));
+            }
+
+          /* strlen. */
+          for (i = 0; i < size; i++)
+            src[s_ofs + i] |= 1;
+          src[s_ofs + size] = '\0';
+          ASSERT (strlen ((char *) src + s_ofs) == size);
+        }
+}
+
+/* Runs FAST and SLOW BENCH_REPS times each and prints the time
+   each took. */
+static void
+bench (const char *name, void (*fast) (void), void (*slow) (void))
+{
+  int64_t start, fast_ticks, slow_ticks;
+  int i;
+
+  start = timer_ticks ();
+  for (i = 0; i < BENCH_REPS; i++)
+    fast ();
+  fast_ticks = timer_elapsed (start);
+
+  start = timer_ticks ();
+  for (i = 0; i < BENCH_REPS; i++)
+    slow ();
+  slow_ticks = timer_elapsed (start);
+
+  printf ("%s: %d x %d bytes: %"PRId64" ticks, byte loop %"PRId64" ticks",
+          name, BENCH_REPS, BENCH_SIZE, fast_ticks, slow_ticks);
+  if (fast_ticks > 0)
+    printf (", %"PRId64".%"PRId64"x faster",
+            slow_ticks / fast_ticks, slow_ticks * 10 / fast_ticks % 10);
+  printf ("\n");
+}
@@ -0,0 +1,206 @@
+/* Test program for the reader-writer and sequence locks in
+   threads/synch.c.
+
+   Runs a few threads at a higher priority than the main thread,
+   so that each one runs as far as it can as soon as it is
+   created or woken up, and checks who gets in when.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/test.h"
+
+/* Priority of the threads we create. */
+#define PRI_TEST (PRI_DEFAULT + 1)
+
+static void test_rwlock (void);
+static void test_seqlock (void);
+
+/* Test the reader-writer and sequence locks. */
+void
+test (void)
+{
+  printf ("testing rwlock...");
+  test_rwlock ();
+  printf (" done\n");
+
+  printf ("testing seqlock...");
+  test_seqlock ();
+  printf (" done\n");
+
+  printf ("synch: PASS\n");
+}
+
+/* Shared state of the rwlock test. */
+static struct rwlock rw;
+static int readers_in;                  /* Threads inside for reading. */
+static bool writer_in;                  /* A thread is inside for writing. */
+static char order[8];                   /* Names of threads, as they got in. */
+static struct semaphore entered;        /* Upped by each thread once inside. */
+static struct semaphore leave_a;        /* Lets reader A leave. */
+static struct semaphore leave_w;        /* Lets the writer leave. */
+static struct semaphore done;           /* Upped by each thread on exit. */
+
+static void
+enter (const char *name)
+{
+  strlcat (order, name, sizeof order);
+  sema_up (&entered);
+}
+
+static void
+reader_a (void *aux UNUSED)
+{
+  rwlock_read_acquire (&rw);
+  ASSERT (!writer_in);
+  readers_in++;
+  enter ("A");
+
+  sema_down (&leave_a);
+  readers_in--;
+  rwlock_read_release (&rw);
+  sema_up (&done);
+}
+
+static void
+reader_b (void *aux UNUSED)
+{
+  rwlock_read_acquire (&rw);
+  ASSERT (!writer_in);
+  readers_in++;
+  enter ("B");
+
+  readers_in--;
+  rwlock_read_release (&rw);
+  sema_up (&done);
+}
+
+static void
+writer (void *aux UNUSED)
+{
+  rwlock_write_acquire (&rw);
+  ASSERT (rwlock_held_for_write (&rw));
+  ASSERT (readers_in == 0 && !writer_in);
+  writer_in = true;
+  enter ("W");
+
+  sema_down (&leave_w);
+  writer_in = false;
+  rwlock_write_release (&rw);
+  sema_up (&done);
+}
+
+/* Readers share the lock, a writer waits for all of them to
+   leave, and a reader that comes after a waiting writer gets in
+   only once that writer is done. */
+static void
+test_rwlock (void)
+{
+  int i;
+
+  rwlock_init (&rw);
+  sema_init (&entered, 0);
+  sema_init (&leave_a, 0);
+  sema_init (&leave_w, 0);
+  sema_init (&done, 0);
+
+  /* Two readers at once. */
+  rwlock_read_acquire (&rw);
+  readers_in++;
+  thread_create ("reader A", PRI_TEST, reader_a, NULL);
+  sema_down (&entered);
+  ASSERT (readers_in == 2);
+
+  /* The writer waits for both readers, and reader B, arriving
+     later, waits for the writer. */
+  thread_create ("writer", PRI_TEST, writer, NULL);
+  ASSERT (!writer_in);
+  thread_create ("reader B", PRI_TEST, reader_b, NULL);
+  ASSERT (readers_in == 2);
+  ASSERT (!strcmp (order, "A"));
+
+  /* Still one reader inside. */
+  readers_in--;
+  rwlock_read_release (&rw);
+  ASSERT (!writer_in);
+  ASSERT (!strcmp (order, "A"));
+
+  /* The last reader out lets the writer in, but not B. */
+  sema_up (&leave_a);
+  sema_down (&entered);
+  ASSERT (writer_in && readers_in == 0);
+  ASSERT (!strcmp (order, "AW"));
+
+  /* The writer lets B in. */
+  sema_up (&leave_w);
+  sema_down (&entered);
+  ASSERT (!strcmp (order, "AWB"));
+
+  for (i = 0; i < 3; i++)
+    sema_down (&done);
+  ASSERT (readers_in == 0 && !writer_in);
+}
+
+/* Shared state of the seqlock test.  X and Y are always equal
+   outside of a write. */
+static struct seqlock sl;
+static int x, y;
+static bool read_done;
+
+static void
+seq_reader (void *aux UNUSED)
+{
+  unsigned start;
+  int rx, ry;
+
+  do
+    {
+      start = seqlock_read_begin (&sl);
+      rx = x;
+      ry = y;
+    }
+  while (seqlock_read_retry (&sl, start));
+  ASSERT (rx == ry);
+  read_done = true;
+}
+
+/* A read overlapped by a write must be retried, and a reader
+   that starts during a write waits for it to end. */
+static void
+test_seqlock (void)
+{
+  unsigned start;
+
+  seqlock_init (&sl);
+  x = y = 0;
+
+  start = seqlock_read_begin (&sl);
+  ASSERT (!seqlock_read_retry (&sl, start));
+
+  seqlock_write_begin (&sl);
+  x++;
+  y++;
+  seqlock_write_end (&sl);
+  ASSERT (seqlock_read_retry (&sl, start));
+
+  start = seqlock_read_begin (&sl);
+  ASSERT (!seqlock_read_retry (&sl, start));
+
+  /* The reader must not see X and Y half updated. */
+  read_done = false;
+  seqlock_write_begin (&sl);
+  x++;
+  thread_create ("seq reader", PRI_TEST, seq_reader, NULL);
+  ASSERT (!read_done);
+  y++;
+  seqlock_write_end (&sl);
+  ASSERT (read_done);
+  ASSERT (x == 2 && y == 2);
+}
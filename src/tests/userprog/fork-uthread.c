@@ -0,0 +1,67 @@
+/* Forks from the main thread while a user thread is running,
+   then from that user thread, and checks that each child can
+   start user threads of its own.  The children must not mistake
+   the stacks of threads left behind in the parent for free
+   stack slots. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int go;
+
+/* Does nothing, as a user thread of a child. */
+static void
+idle (void *aux UNUSED) 
+{
+}
+
+/* Starts and joins a user thread in a forked child, then exits
+   with STATUS. */
+static void
+run_child (const char *forker, int status) 
+{
+  int tid = uthread_create (idle, NULL);
+  if (tid == -1)
+    fail ("child of %s could not make a thread", forker);
+  uthread_join (tid);
+  msg ("child of %s made a thread", forker);
+  exit (status);
+}
+
+/* Waits for the main thread's signal, then forks. */
+static void
+forker (void *aux UNUSED) 
+{
+  pid_t pid;
+  int status;
+
+  while (go == 0)
+    futex_wait (&go, 0);
+  pid = fork ();
+  if (pid == 0)
+    run_child ("user thread", 82);
+  status = wait (pid);
+  CHECK (status == 82, "wait for child of user thread");
+}
+
+void
+test_main (void) 
+{
+  pid_t pid;
+  int tid, status;
+
+  tid = uthread_create (forker, NULL);
+  CHECK (tid != -1, "uthread_create");
+
+  pid = fork ();
+  if (pid == 0)
+    run_child ("main thread", 81);
+  status = wait (pid);
+  CHECK (status == 81, "wait for child of main thread");
+
+  go = 1;
+  futex_wake (&go, 1);
+  status = uthread_join (tid);
+  CHECK (status == 0, "uthread_join");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fork-uthread) begin
+(fork-uthread) uthread_create
+(fork-uthread) child of main thread made a thread
+fork-uthread: exit(81)
+(fork-uthread) wait for child of main thread
+(fork-uthread) child of user thread made a thread
+fork-uthread: exit(82)
+(fork-uthread) wait for child of user thread
+(fork-uthread) uthread_join
+(fork-uthread) end
+fork-uthread: exit(0)
+EOF
+pass;
@@ -0,0 +1,38 @@
+/* Unmaps a shared memory segment while a user thread is blocked
+   in read() on a pipe into it.  The unmap must go through and the
+   read must fail once data arrives, rather than the kernel
+   faulting on the page that is gone. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int fds[2];
+static char *buf;
+static int result;
+
+/* Reads from the pipe into the segment. */
+static void
+reader (void *aux UNUSED) 
+{
+  result = read (fds[0], buf, 100);
+}
+
+void
+test_main (void) 
+{
+  int tid;
+
+  buf = shm_map ("shm-unmap-read", 4096);
+  CHECK (buf != NULL, "shm_map");
+  CHECK (pipe (fds) == 0, "pipe");
+  tid = uthread_create (reader, NULL);
+  CHECK (tid != -1, "uthread_create");
+
+  /* Give the reader time to block in read(). */
+  poll (NULL, 0, 100);
+  CHECK (shm_unmap (buf), "shm_unmap while reading");
+  CHECK (write (fds[1], "data", 4) == 4, "write to pipe");
+  uthread_join (tid);
+  CHECK (result == -1, "read into unmapped segment failed");
+}
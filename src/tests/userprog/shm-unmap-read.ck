@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(shm-unmap-read) begin
+(shm-unmap-read) shm_map
+(shm-unmap-read) pipe
+(shm-unmap-read) uthread_create
+(shm-unmap-read) shm_unmap while reading
+(shm-unmap-read) write to pipe
+(shm-unmap-read) read into unmapped segment failed
+(shm-unmap-read) end
+shm-unmap-read: exit(0)
+EOF
+pass;
@@ -0,0 +1,73 @@
+/* Spawns child-simple with as many arguments as a process can
+   get, just filling the stack page below the initial stack
+   pointer, 12 bytes under PHYS_BASE.  The child loads, but has
+   no stack left to run on, so it dies on its first push.  Then
+   tries again with one byte more, which must fail to load. */
+
+#include <spawn.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* The strings, then argv[] with its null terminator, an empty
+   envp[], and envp, argv, argc and a return address for _start(). */
+#define ARGC SPAWN_ARG_MAX
+#define STACK_ROOM (4096 - 12)
+#define STRINGS_SIZE (STACK_ROOM - (ARGC + 2 + 4) * sizeof (char *))
+
+static char strings[STRINGS_SIZE + 1];
+static char *argv[ARGC + 1];
+
+/* Fills argv[] with "child-simple" and ARGC - 1 arguments of x's,
+   SIZE bytes in all with their null terminators. */
+static void
+make_args (size_t size) 
+{
+  static const char name[] = "child-simple";
+  size_t rest = size - sizeof name;
+  char *p = strings;
+  int i;
+
+  memcpy (p, name, sizeof name);
+  argv[0] = p;
+  p += sizeof name;
+  for (i = 1; i < ARGC; i++) 
+    {
+      size_t len = rest / (ARGC - 1) + ((size_t) i <= rest % (ARGC - 1));
+      memset (p, 'x', len - 1);
+      p[len - 1] = '\0';
+      argv[i] = p;
+      p += len;
+    }
+  argv[ARGC] = NULL;
+}
+
+/* Spawns one child with the arguments in argv[] and returns its
+   pid, or -1. */
+static pid_t
+spawn_one (void) 
+{
+  struct spawn_args sa = { NULL, argv, NULL, NULL, 0 };
+  pid_t pid;
+
+  if (spawn (&sa, 1, &pid) != 1)
+    return -1;
+  return pid;
+}
+
+void
+test_main (void) 
+{
+  pid_t pid;
+
+  make_args (STRINGS_SIZE);
+  pid = spawn_one ();
+  if (pid == -1)
+    fail ("spawn with a full stack page failed");
+  msg ("spawn with a full stack page: ok");
+  msg ("wait(spawn()) = %d", wait (pid));
+
+  make_args (STRINGS_SIZE + 1);
+  msg ("spawn with one byte more: %d", spawn_one ());
+}
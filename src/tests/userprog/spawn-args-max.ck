@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF', <<'EOF']);
+(spawn-args-max) begin
+(spawn-args-max) spawn with a full stack page: ok
+child-simple: exit(-1)
+(spawn-args-max) wait(spawn()) = -1
+(spawn-args-max) spawn with one byte more: -1
+(spawn-args-max) end
+spawn-args-max: exit(0)
+EOF
+(spawn-args-max) begin
+child-simple: exit(-1)
+(spawn-args-max) spawn with a full stack page: ok
+(spawn-args-max) wait(spawn()) = -1
+(spawn-args-max) spawn with one byte more: -1
+(spawn-args-max) end
+spawn-args-max: exit(0)
+EOF
+pass;
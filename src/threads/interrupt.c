@@ -9,6 +9,9 @@
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "devices/timer.h"
+#ifdef USERPROG
+#include "userprog/process.h"
+#endif
 
 /* Programmable Interrupt Controller (PIC) registers.
    A PC has two PICs, called the master and slave PICs, with the
@@ -386,6 +389,15 @@ intr_handler (struct intr_frame *frame)
       if (yield_on_return) 
         thread_yield (); 
     }
+
+#ifdef USERPROG
+  /* A thread whose process is exiting dies on its way back to
+     user mode (ring 3), whether it entered the kernel through a
+     system call, an exception, or an external interrupt, which is
+     complete by now. */
+  if ((frame->cs & 3) == 3)
+    process_check_killed ();
+#endif
 }
 
 /* Handles an unexpected interrupt with interrupt frame F.  An
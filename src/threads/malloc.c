@@ -5,41 +5,57 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/memprof.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc()
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request
+   The size of each request, in bytes, is rounded up to the next
+   size class and assigned to the "descriptor" that manages blocks
+   of that size.  Classes are 16 bytes apart up to 256 bytes and
+   then eight to each power of 2, so no more than about 12.5% of
+   a block is wasted.  The descriptor keeps a list of the arenas
+   that have free blocks.  If the list is nonempty, a block is
+   taken from the free list of its first arena to satisfy the
+   request
 
    Otherwise, a new page of memory, called an "arena", is
    obtained from the page allocator (if none is available,
    malloc() returns a null pointer).  The new arena is divided
-   into blocks, all of which are added to the descriptor's free
-   list.  Then we return one of the new blocks
+   into blocks, all of which are added to the arena's free list.
+   Then we return one of the new blocks
 
-   When we free a block, we add it to its descriptor's free list.
-   But if the arena that the block was in now has no in-use
-   blocks, we remove all of the arena's blocks from the free list
-   and give the arena back to the page allocator
+   When we free a block, we add it to its arena's free list.  If
+   the arena now has no in-use blocks, we take it off the
+   descriptor's list and give it back to the page allocator,
+   which takes constant time since its blocks are on no other
+   list
+
+   Each thread also keeps a few free blocks of each of the
+   smallest classes for itself.  malloc() and free() of those
+   sizes use the thread's cache without taking the descriptor's
+   lock, and only refill or drain it, half a cache at a time,
+   under the lock.  A thread's cache is given back when it exits
 
    We can't handle blocks bigger than 2 kB using this scheme,
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header */
+   the beginning of the allocated block's arena header
+
+   When built with -DMEMPROF, every block also carries a small
+   header recording its size and the call site that allocated it,
+   for the memory profiler */
 
 /* Descriptor. */
 struct desc
   {
     size_t block_size;          /* Size of each element in bytes. */
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
-    struct list free_list;      /* List of free blocks. */
+    struct list arenas;         /* Arenas with at least one free block. */
     struct lock lock;           /* Lock. */
   };
 
@@ -52,35 +68,77 @@ struct arena
     unsigned magic;             /* Always set to ARENA_MAGIC. */
     struct desc *desc;          /* Owning descriptor, null for big block. */
     size_t free_cnt;            /* Free blocks; pages in big block. */
+    struct list_elem elem;      /* Element in desc's arenas if free_cnt > 0. */
+    struct block *free;         /* First free block. */
   };
 
 /* Free block. */
 struct block 
   {
-    struct list_elem free_elem; /* Free list element. */
+    struct block *next;         /* Next free block in arena or cache. */
   };
 
+/* Size classes are multiples of SIZE_STEP. */
+#define SIZE_STEP 16
+
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[40];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Index into descs[] of the smallest descriptor whose blocks
+   hold N * SIZE_STEP bytes. */
+static uint8_t size_to_desc[PGSIZE / 2 / SIZE_STEP + 1];
+
+/* Most blocks of one class a thread caches. */
+#define MALLOC_CACHE_MAX 8
+
+#ifdef MEMPROF
+/* Profiler header, in front of each block handed out. */
+struct prof_header
+  {
+    size_t size;                /* Requested size in bytes. */
+    unsigned site;              /* Call site, from memprof_alloc(). */
+  };
+#endif
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static struct block *alloc_block (struct desc *);
+static void free_block (struct desc *, struct block *);
+static void cache_refill (struct thread *, size_t idx);
+static void cache_drain (struct thread *, size_t idx, size_t cnt);
+static void *alloc_for (size_t size, const void *caller);
+static void *raw_malloc (size_t size);
+static void raw_free (void *p);
 
 /* Initializes the malloc() descriptors. */
 void
 malloc_init (void) 
 {
-  size_t block_size;
+  size_t block_size, step, i, idx;
 
-  for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2)
+  step = SIZE_STEP;
+  for (block_size = SIZE_STEP;
+       2 * block_size + sizeof (struct arena) <= PGSIZE;
+       block_size += step)
     {
       struct desc *d = &descs[desc_cnt++];
       ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
       d->block_size = block_size;
       d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-      list_init (&d->free_list);
+      list_init (&d->arenas);
       lock_init (&d->lock);
+
+      /* Eight classes per power of 2 from here on. */
+      if (block_size >= 16 * step)
+        step *= 2;
+    }
+
+  for (i = 0, idx = 0; i < sizeof size_to_desc; i++)
+    {
+      while (idx < desc_cnt - 1 && descs[idx].block_size < i * SIZE_STEP)
+        idx++;
+      size_to_desc[i] = idx;
     }
 }
 
@@ -88,10 +146,39 @@ malloc_init (void)
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size) 
+{
+  return alloc_for (size, __builtin_return_address (0));
+}
+
+/* Allocates SIZE bytes, as malloc(), on behalf of CALLER. */
+static void *
+alloc_for (size_t size, const void *caller UNUSED)
+{
+#ifdef MEMPROF
+  struct prof_header *h;
+
+  if (size == 0)
+    return NULL;
+  h = raw_malloc (size + sizeof *h);
+  if (h == NULL)
+    return NULL;
+  h->size = size;
+  h->site = memprof_alloc (caller, MEMPROF_MALLOC, size);
+  return h + 1;
+#else
+  return raw_malloc (size);
+#endif
+}
+
+/* Obtains and returns a new block of at least SIZE bytes from
+   the size classes or the page allocator. */
+static void *
+raw_malloc (size_t size)
 {
   struct desc *d;
   struct block *b;
   struct arena *a;
+  size_t idx;
 
   /* A null pointer satisfies a request for 0 bytes. */
   if (size == 0)
@@ -99,10 +186,7 @@ malloc (size_t size)
 
   /* Find the smallest descriptor that satisfies a SIZE-byte
      request. */
-  for (d = descs; d < descs + desc_cnt; d++)
-    if (d->block_size >= size)
-      break;
-  if (d == descs + desc_cnt) 
+  if (size > descs[desc_cnt - 1].block_size)
     {
       /* SIZE is too big for any descriptor.
          Allocate enough pages to hold SIZE plus an arena. */
@@ -118,37 +202,29 @@ malloc (size_t size)
       a->free_cnt = page_cnt;
       return a + 1;
     }
+  idx = size_to_desc[DIV_ROUND_UP (size, SIZE_STEP)];
+  d = &descs[idx];
+  ASSERT (d->block_size >= size);
 
-  lock_acquire (&d->lock);
-
-  /* If the free list is empty, create a new arena. */
-  if (list_empty (&d->free_list))
+  /* Small blocks come from the thread's own cache. */
+  if (idx < MALLOC_CACHE_CLASSES)
     {
-      size_t i;
+      struct thread *t = thread_current ();
 
-      /* Allocate a page. */
-      a = palloc_get_page (0);
-      if (a == NULL) 
-        {
-          lock_release (&d->lock);
-          return NULL; 
-        }
-
-      /* Initialize arena and add its blocks to the free list. */
-      a->magic = ARENA_MAGIC;
-      a->desc = d;
-      a->free_cnt = d->blocks_per_arena;
-      for (i = 0; i < d->blocks_per_arena; i++) 
+      if (t->malloc_cache_cnt[idx] == 0)
         {
-          struct block *b = arena_to_block (a, i);
-          list_push_back (&d->free_list, &b->free_elem);
+          cache_refill (t, idx);
+          if (t->malloc_cache_cnt[idx] == 0)
+            return NULL;
         }
+      b = t->malloc_cache[idx];
+      t->malloc_cache[idx] = b->next;
+      t->malloc_cache_cnt[idx]--;
+      return b;
     }
 
-  /* Get a block from free list and return it. */
-  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-  a = block_to_arena (b);
-  a->free_cnt--;
+  lock_acquire (&d->lock);
+  b = alloc_block (d);
   lock_release (&d->lock);
   return b;
 }
@@ -167,7 +243,7 @@ calloc (size_t a, size_t b)
     return NULL;
 
   /* Allocate and zero memory. */
-  p = malloc (size);
+  p = alloc_for (size, __builtin_return_address (0));
   if (p != NULL)
     memset (p, 0, size);
 
@@ -178,11 +254,15 @@ calloc (size_t a, size_t b)
 static size_t
 block_size (void *block) 
 {
+#ifdef MEMPROF
+  return ((struct prof_header *) block)[-1].size;
+#else
   struct block *b = block;
   struct arena *a = block_to_arena (b);
   struct desc *d = a->desc;
 
   return d != NULL ? d->block_size : PGSIZE * a->free_cnt - pg_ofs (block);
+#endif
 }
 
 /* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
@@ -201,7 +281,7 @@ realloc (void *old_block, size_t new_size)
     }
   else 
     {
-      void *new_block = malloc (new_size);
+      void *new_block = alloc_for (new_size, __builtin_return_address (0));
       if (old_block != NULL && new_block != NULL)
         {
           size_t old_size = block_size (old_block);
@@ -217,6 +297,21 @@ realloc (void *old_block, size_t new_size)
    malloc(), calloc(), or realloc(). */
 void
 free (void *p) 
+{
+#ifdef MEMPROF
+  if (p != NULL)
+    {
+      struct prof_header *h = (struct prof_header *) p - 1;
+      memprof_free (h->site, h->size);
+      p = h;
+    }
+#endif
+  raw_free (p);
+}
+
+/* Frees block P, which must have come from raw_malloc(). */
+static void
+raw_free (void *p)
 {
   if (p != NULL)
     {
@@ -227,31 +322,27 @@ free (void *p)
       if (d != NULL) 
         {
           /* It's a normal block.  We handle it here. */
+          size_t idx = d - descs;
 
 #ifndef NDEBUG
           /* Clear the block to help detect use-after-free bugs. */
           memset (b, 0xcc, d->block_size);
 #endif
-  
-          lock_acquire (&d->lock);
 
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
-
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena) 
+          if (idx < MALLOC_CACHE_CLASSES)
             {
-              size_t i;
-
-              ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++) 
-                {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
-                }
-              palloc_free_page (a);
+              /* Keep it in the thread's cache. */
+              struct thread *t = thread_current ();
+
+              b->next = t->malloc_cache[idx];
+              t->malloc_cache[idx] = b;
+              if (++t->malloc_cache_cnt[idx] > MALLOC_CACHE_MAX)
+                cache_drain (t, idx, MALLOC_CACHE_MAX / 2);
+              return;
             }
-
+  
+          lock_acquire (&d->lock);
+          free_block (d, b);
           lock_release (&d->lock);
         }
       else
@@ -262,7 +353,131 @@ free (void *p)
         }
     }
 }
-
+
+/* Gives the blocks in the current thread's cache back to their
+   arenas.  Called when the thread exits. */
+void
+malloc_thread_exit (void)
+{
+  struct thread *t = thread_current ();
+  size_t idx;
+
+  for (idx = 0; idx < MALLOC_CACHE_CLASSES; idx++)
+    cache_drain (t, idx, t->malloc_cache_cnt[idx]);
+}
+
+/* Takes a free block from descriptor D, creating a new arena if
+   D has no free blocks.  Returns a null pointer if memory is not
+   available.  D's lock must be held. */
+static struct block *
+alloc_block (struct desc *d)
+{
+  struct arena *a;
+  struct block *b;
+
+  ASSERT (lock_held_by_current_thread (&d->lock));
+
+  /* If no arena has a free block, create a new arena. */
+  if (list_empty (&d->arenas))
+    {
+      size_t i;
+
+      /* Allocate a page. */
+      a = palloc_get_page (0);
+      if (a == NULL) 
+        return NULL; 
+
+      /* Initialize arena and put its blocks on its free list. */
+      a->magic = ARENA_MAGIC;
+      a->desc = d;
+      a->free_cnt = d->blocks_per_arena;
+      a->free = NULL;
+      for (i = d->blocks_per_arena; i-- > 0; )
+        {
+          b = arena_to_block (a, i);
+          b->next = a->free;
+          a->free = b;
+        }
+      list_push_front (&d->arenas, &a->elem);
+    }
+
+  /* Get a block from the first arena's free list. */
+  a = list_entry (list_front (&d->arenas), struct arena, elem);
+  b = a->free;
+  a->free = b->next;
+  if (--a->free_cnt == 0)
+    list_remove (&a->elem);
+  return b;
+}
+
+/* Returns block B to its arena in descriptor D, freeing the
+   arena if none of its blocks remain in use.  D's lock must be
+   held. */
+static void
+free_block (struct desc *d, struct block *b)
+{
+  struct arena *a = block_to_arena (b);
+
+  ASSERT (lock_held_by_current_thread (&d->lock));
+  ASSERT (a->desc == d);
+
+  b->next = a->free;
+  a->free = b;
+  if (a->free_cnt++ == 0)
+    list_push_front (&d->arenas, &a->elem);
+
+  /* If the arena is now entirely unused, free it. */
+  if (a->free_cnt >= d->blocks_per_arena) 
+    {
+      ASSERT (a->free_cnt == d->blocks_per_arena);
+      list_remove (&a->elem);
+      palloc_free_page (a);
+    }
+}
+
+/* Moves up to half a cache of blocks of class IDX from the
+   descriptor into T's cache. */
+static void
+cache_refill (struct thread *t, size_t idx)
+{
+  struct desc *d = &descs[idx];
+  size_t i;
+
+  lock_acquire (&d->lock);
+  for (i = 0; i < MALLOC_CACHE_MAX / 2; i++)
+    {
+      struct block *b = alloc_block (d);
+      if (b == NULL)
+        break;
+      b->next = t->malloc_cache[idx];
+      t->malloc_cache[idx] = b;
+      t->malloc_cache_cnt[idx]++;
+    }
+  lock_release (&d->lock);
+}
+
+/* Returns CNT blocks of class IDX from T's cache to their
+   arenas. */
+static void
+cache_drain (struct thread *t, size_t idx, size_t cnt)
+{
+  struct desc *d = &descs[idx];
+
+  if (cnt == 0)
+    return;
+
+  ASSERT (cnt <= t->malloc_cache_cnt[idx]);
+  lock_acquire (&d->lock);
+  while (cnt-- > 0)
+    {
+      struct block *b = t->malloc_cache[idx];
+      t->malloc_cache[idx] = b->next;
+      t->malloc_cache_cnt[idx]--;
+      free_block (d, b);
+    }
+  lock_release (&d->lock);
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
@@ -4,10 +4,14 @@
 #include <debug.h>
 #include <stddef.h>
 
+/* Number of smallest size classes each thread caches blocks of. */
+#define MALLOC_CACHE_CLASSES 8
+
 void malloc_init (void);
 void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
 void free (void *);
+void malloc_thread_exit (void);
 
 #endif /* threads/malloc.h */
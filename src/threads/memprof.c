@@ -0,0 +1,143 @@
+#include "threads/memprof.h"
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "threads/interrupt.h"
+
+#ifdef MEMPROF
+
+/* The allocators keep, with each allocation, the index of the
+   call site that made it, and hand it back to memprof_free().
+   Sites live in a fixed open-addressed table keyed by caller and
+   kind; once it fills up, further sites share slot 0, which is
+   never claimed by a caller.  Pages are
+   freed from the scheduler, so the table is protected by turning
+   interrupts off. */
+
+/* Number of call sites tracked, including the overflow slot. */
+#define SITE_CNT 256
+
+/* A call site. */
+struct site
+  {
+    const void *caller;         /* Return address of the allocation call. */
+    enum memprof_kind kind;     /* Allocator used. */
+    size_t live_bytes;          /* Bytes allocated and not yet freed. */
+    size_t live_cnt;            /* Allocations not yet freed. */
+    size_t peak_bytes;          /* Maximum of live_bytes. */
+    size_t total_cnt;           /* Allocations ever made. */
+  };
+
+static struct site sites[SITE_CNT];
+
+static const char *kind_names[MEMPROF_KIND_CNT] = {"malloc", "palloc"};
+
+/* Returns the index of the site for CALLER and KIND, claiming a
+   free slot if it is new. */
+static unsigned
+lookup_site (const void *caller, enum memprof_kind kind)
+{
+  unsigned start = ((uintptr_t) caller >> 2) * 2654435761u % (SITE_CNT - 1);
+  unsigned i = start;
+
+  do
+    {
+      struct site *s = &sites[i + 1];
+      if (s->total_cnt == 0 || (s->caller == caller && s->kind == kind))
+        {
+          s->caller = caller;
+          s->kind = kind;
+          return i + 1;
+        }
+      i = (i + 1) % (SITE_CNT - 1);
+    }
+  while (i != start);
+
+  return 0;
+}
+
+/* Charges an allocation of SIZE bytes to CALLER, which used
+   allocator KIND.  Returns the site index to pass to
+   memprof_free() when the allocation is freed. */
+unsigned
+memprof_alloc (const void *caller, enum memprof_kind kind, size_t size)
+{
+  enum intr_level old_level = intr_disable ();
+  unsigned idx = lookup_site (caller, kind);
+  struct site *s = &sites[idx];
+
+  s->live_bytes += size;
+  s->live_cnt++;
+  s->total_cnt++;
+  if (s->live_bytes > s->peak_bytes)
+    s->peak_bytes = s->live_bytes;
+  intr_set_level (old_level);
+
+  return idx;
+}
+
+/* Credits SIZE freed bytes to site SITE. */
+void
+memprof_free (unsigned site, size_t size)
+{
+  enum intr_level old_level;
+  struct site *s;
+
+  ASSERT (site < SITE_CNT);
+  s = &sites[site];
+
+  old_level = intr_disable ();
+  ASSERT (s->live_cnt > 0 && s->live_bytes >= size);
+  s->live_bytes -= size;
+  s->live_cnt--;
+  intr_set_level (old_level);
+}
+
+/* Orders sites by decreasing live bytes, then decreasing peak. */
+static int
+compare_sites (const void *a_, const void *b_)
+{
+  const struct site *a = a_;
+  const struct site *b = b_;
+
+  if (a->live_bytes != b->live_bytes)
+    return a->live_bytes > b->live_bytes ? -1 : 1;
+  if (a->peak_bytes != b->peak_bytes)
+    return a->peak_bytes > b->peak_bytes ? -1 : 1;
+  return 0;
+}
+
+/* Prints every call site that ever allocated, largest holders
+   first.  Sites with live allocations at shutdown are leaks or
+   long-lived caches. */
+void
+memprof_print_stats (void)
+{
+  static struct site snapshot[SITE_CNT];
+  enum intr_level old_level;
+  size_t i;
+
+  old_level = intr_disable ();
+  for (i = 0; i < SITE_CNT; i++)
+    snapshot[i] = sites[i];
+  intr_set_level (old_level);
+
+  qsort (snapshot, SITE_CNT, sizeof *snapshot, compare_sites);
+
+  printf ("Memprof: live bytes by call site:\n");
+  for (i = 0; i < SITE_CNT; i++)
+    {
+      const struct site *s = &snapshot[i];
+      if (s->total_cnt == 0)
+        continue;
+      if (s->caller != NULL)
+        printf ("Memprof: %s %p: ", kind_names[s->kind], s->caller);
+      else
+        printf ("Memprof: other sites: ");
+      printf ("%zu bytes in %zu live, peak %zu bytes, %zu allocations\n",
+              s->live_bytes, s->live_cnt, s->peak_bytes, s->total_cnt);
+    }
+}
+
+#endif /* MEMPROF */
@@ -0,0 +1,28 @@
+#ifndef THREADS_MEMPROF_H
+#define THREADS_MEMPROF_H
+
+#include <stddef.h>
+
+/* Kernel memory profiler.
+
+   Built only when the kernel is compiled with -DMEMPROF, e.g. by
+   adding it to DEFINES in the Make.vars of the project being
+   built.  Then every malloc() and palloc_get_*() call is charged
+   to its call site, and the report printed at shutdown shows the
+   bytes each site still holds.  Sites are printed as return
+   addresses; feed them to the "backtrace" utility to get
+   function names and line numbers. */
+
+/* Kinds of allocation. */
+enum memprof_kind
+  {
+    MEMPROF_MALLOC,             /* malloc(), calloc(), realloc(). */
+    MEMPROF_PALLOC,             /* palloc_get_page(), palloc_get_multiple(). */
+    MEMPROF_KIND_CNT
+  };
+
+unsigned memprof_alloc (const void *caller, enum memprof_kind, size_t size);
+void memprof_free (unsigned site, size_t size);
+void memprof_print_stats (void);
+
+#endif /* threads/memprof.h */
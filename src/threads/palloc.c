@@ -7,7 +7,9 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
+#include "threads/memprof.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
@@ -23,7 +25,40 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes */
+   kernel pool, but that's just fine for demonstration purposes
+
+   Each pool hands out pages first-fit from its bitmap, or, with
+   the "-buddy" option, from a binary buddy allocator.  A buddy
+   block of order K is 2**K pages whose index within the pool is
+   a multiple of 2**K.  Free blocks sit on per-order free lists,
+   linked through their first page, and a freed block is merged
+   with its buddy as long as the buddy is free too.  Requests
+   that are not a power of two take the smallest block that fits
+   and give the tail back at once.  The bitmap still records which
+   pages are in use in either mode.
+
+   In front of either allocator each pool keeps a "magazine", a
+   small stack of recently freed single pages.  Pages in the
+   magazine still count as used in the bitmap.  Taking a page from
+   or putting one into the magazine needs only interrupts off, not
+   the pool lock; the pool is touched only to refill the magazine
+   in a batch when it runs empty or to drain half of it when it
+   fills up. */
+
+/* Pages held by each pool's magazine, and how many to move
+   between the magazine and the pool at once. */
+#define MAGAZINE_SIZE 16
+#define MAGAZINE_BATCH (MAGAZINE_SIZE / 2)
+
+/* Largest buddy block is 2**BUDDY_MAX_ORDER pages. */
+#define BUDDY_MAX_ORDER 10
+
+/* free_order[] value for a page that does not start a free block. */
+#define BUDDY_NOT_FREE 0xff
+
+/* If true, use the buddy allocator.
+   Controlled by kernel command-line option "-buddy". */
+bool palloc_buddy;
 
 /* A memory pool. */
 struct pool
@@ -31,6 +66,27 @@ struct pool
     struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
     uint8_t *base;                      /* Base of pool. */
+
+    /* Buddy allocator, only if palloc_buddy.
+       Protected by turning interrupts off rather than by LOCK,
+       because pages are freed from the scheduler. */
+    uint8_t *free_order;                /* Order of free block at each page. */
+    struct list free_lists[BUDDY_MAX_ORDER + 1]; /* Free blocks by order. */
+    size_t free_cnt[BUDDY_MAX_ORDER + 1];        /* Length of each list. */
+    size_t split_cnt;                   /* Blocks split in two. */
+    size_t merge_cnt;                   /* Buddies merged. */
+
+    /* Cache of free single pages.  Protected by turning
+       interrupts off. */
+    void *magazine[MAGAZINE_SIZE];      /* Cached pages. */
+    size_t magazine_cnt;                /* Number of cached pages. */
+    size_t hit_cnt;                     /* Pages taken from the magazine. */
+    size_t refill_cnt;                  /* Refills from the pool. */
+    size_t drain_cnt;                   /* Drains back to the pool. */
+
+#ifdef MEMPROF
+    uint16_t *page_site;                /* Profiler site of each allocation. */
+#endif
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -39,6 +95,15 @@ static struct pool kernel_pool, user_pool;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static void *get_pages (enum palloc_flags, size_t page_cnt,
+                        const void *caller);
+static size_t pool_alloc (struct pool *, size_t page_cnt);
+static void pool_free (struct pool *, size_t page_idx, size_t page_cnt);
+static void *magazine_get (struct pool *);
+static void magazine_put (struct pool *, void *page);
+static bool magazine_drain (struct pool *, size_t page_cnt);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -69,6 +134,28 @@ palloc_init (size_t user_page_limit)
    FLAGS, in which case the kernel panics. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
+{
+  return get_pages (flags, page_cnt, __builtin_return_address (0));
+}
+
+/* Obtains a single free page and returns its kernel virtual
+   address.
+   If PAL_USER is set, the page is obtained from the user pool,
+   otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
+   then the page is filled with zeros.  If no pages are
+   available, returns a null pointer, unless PAL_ASSERT is set in
+   FLAGS, in which case the kernel panics. */
+void *
+palloc_get_page (enum palloc_flags flags) 
+{
+  return get_pages (flags, 1, __builtin_return_address (0));
+}
+
+/* Obtains PAGE_CNT pages, as palloc_get_multiple(), on behalf of
+   CALLER. */
+static void *
+get_pages (enum palloc_flags flags, size_t page_cnt,
+           const void *caller UNUSED)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
   void *pages;
@@ -77,17 +164,27 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
-
-  if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
+  if (page_cnt == 1)
+    pages = magazine_get (pool);
   else
-    pages = NULL;
+    {
+      /* Cached pages may be what keeps a run from being free. */
+      page_idx = pool_alloc (pool, page_cnt);
+      if (page_idx == BITMAP_ERROR && magazine_drain (pool, MAGAZINE_SIZE))
+        page_idx = pool_alloc (pool, page_cnt);
+
+      if (page_idx != BITMAP_ERROR)
+        pages = pool->base + PGSIZE * page_idx;
+      else
+        pages = NULL;
+    }
 
   if (pages != NULL) 
     {
+#ifdef MEMPROF
+      pool->page_site[pg_no (pages) - pg_no (pool->base)]
+        = memprof_alloc (caller, MEMPROF_PALLOC, PGSIZE * page_cnt);
+#endif
       if (flags & PAL_ZERO)
         memset (pages, 0, PGSIZE * page_cnt);
     }
@@ -100,19 +197,6 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   return pages;
 }
 
-/* Obtains a single free page and returns its kernel virtual
-   address.
-   If PAL_USER is set, the page is obtained from the user pool,
-   otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
-   then the page is filled with zeros.  If no pages are
-   available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
-void *
-palloc_get_page (enum palloc_flags flags) 
-{
-  return palloc_get_multiple (flags, 1);
-}
-
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) 
@@ -133,12 +217,18 @@ palloc_free_multiple (void *pages, size_t page_cnt)
 
   page_idx = pg_no (pages) - pg_no (pool->base);
 
+#ifdef MEMPROF
+  memprof_free (pool->page_site[page_idx], PGSIZE * page_cnt);
+#endif
 #ifndef NDEBUG
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  if (page_cnt == 1)
+    magazine_put (pool, pages);
+  else
+    pool_free (pool, page_idx, page_cnt);
 }
 
 /* Frees the page at PAGE. */
@@ -156,7 +246,15 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   /* We'll put the pool's used_map at its base.
      Calculate the space needed for the bitmap
      and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
+  size_t bm_size = bitmap_buf_size (page_cnt);
+  size_t meta_size = bm_size + (palloc_buddy ? page_cnt : 0);
+#ifdef MEMPROF
+  size_t site_ofs = ROUND_UP (meta_size, sizeof (uint16_t));
+  meta_size = site_ofs + page_cnt * sizeof (uint16_t);
+#endif
+  size_t bm_pages = DIV_ROUND_UP (meta_size, PGSIZE);
+  int order;
+
   if (bm_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
   page_cnt -= bm_pages;
@@ -165,8 +263,30 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
 
   /* Initialize the pool. */
   lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
   p->base = base + bm_pages * PGSIZE;
+  p->magazine_cnt = 0;
+  p->hit_cnt = p->refill_cnt = p->drain_cnt = 0;
+#ifdef MEMPROF
+  p->page_site = (uint16_t *) ((uint8_t *) base + site_ofs);
+#endif
+
+  if (palloc_buddy)
+    {
+      /* The per-page orders follow the bitmap. */
+      p->free_order = (uint8_t *) base + bm_size;
+      memset (p->free_order, BUDDY_NOT_FREE, page_cnt);
+      for (order = 0; order <= BUDDY_MAX_ORDER; order++)
+        {
+          list_init (&p->free_lists[order]);
+          p->free_cnt[order] = 0;
+        }
+      p->split_cnt = p->merge_cnt = 0;
+
+      /* Mark everything used, then free it into the buddy lists. */
+      bitmap_set_all (p->used_map, true);
+      buddy_free (p, 0, page_cnt);
+    }
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -180,3 +300,279 @@ page_from_pool (const struct pool *pool, void *page)
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Allocates PAGE_CNT contiguous pages from P itself, bypassing
+   the magazine, and returns the index of the first, or
+   BITMAP_ERROR if there is no room. */
+static size_t
+pool_alloc (struct pool *p, size_t page_cnt)
+{
+  size_t page_idx;
+
+  if (palloc_buddy)
+    return buddy_alloc (p, page_cnt);
+
+  lock_acquire (&p->lock);
+  page_idx = bitmap_scan_and_flip (p->used_map, 0, page_cnt, false);
+  lock_release (&p->lock);
+  return page_idx;
+}
+
+/* Returns the PAGE_CNT pages starting at PAGE_IDX to P itself.
+   Does not sleep, so it may be called with interrupts off. */
+static void
+pool_free (struct pool *p, size_t page_idx, size_t page_cnt)
+{
+  if (palloc_buddy)
+    buddy_free (p, page_idx, page_cnt);
+  else
+    bitmap_set_multiple (p->used_map, page_idx, page_cnt, false);
+}
+
+/* Takes a page from P's magazine, refilling it from the pool
+   first if it is empty.  Returns a null pointer if the pool is
+   out of pages too. */
+static void *
+magazine_get (struct pool *p)
+{
+  void *batch[MAGAZINE_BATCH];
+  enum intr_level old_level;
+  size_t batch_cnt;
+  void *page;
+
+  old_level = intr_disable ();
+  if (p->magazine_cnt > 0)
+    {
+      page = p->magazine[--p->magazine_cnt];
+      p->hit_cnt++;
+      intr_set_level (old_level);
+      return page;
+    }
+  intr_set_level (old_level);
+
+  /* Refill.  The pool lock may sleep, so gather the batch with
+     interrupts on. */
+  if (!palloc_buddy)
+    lock_acquire (&p->lock);
+  for (batch_cnt = 0; batch_cnt < MAGAZINE_BATCH; batch_cnt++)
+    {
+      size_t page_idx;
+
+      if (palloc_buddy)
+        page_idx = buddy_alloc (p, 1);
+      else
+        page_idx = bitmap_scan_and_flip (p->used_map, 0, 1, false);
+      if (page_idx == BITMAP_ERROR)
+        break;
+      batch[batch_cnt] = p->base + PGSIZE * page_idx;
+    }
+  if (!palloc_buddy)
+    lock_release (&p->lock);
+
+  if (batch_cnt == 0)
+    return NULL;
+
+  /* Keep the first page, cache the rest.  Frees may have filled
+     the magazine in the meantime. */
+  page = batch[0];
+  old_level = intr_disable ();
+  p->refill_cnt++;
+  while (--batch_cnt > 0)
+    {
+      if (p->magazine_cnt < MAGAZINE_SIZE)
+        p->magazine[p->magazine_cnt++] = batch[batch_cnt];
+      else
+        pool_free (p, pg_no (batch[batch_cnt]) - pg_no (p->base), 1);
+    }
+  intr_set_level (old_level);
+
+  return page;
+}
+
+/* Puts PAGE into P's magazine, first draining half of it back
+   to the pool if it is full. */
+static void
+magazine_put (struct pool *p, void *page)
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (p->magazine_cnt == MAGAZINE_SIZE)
+    magazine_drain (p, MAGAZINE_BATCH);
+  p->magazine[p->magazine_cnt++] = page;
+  intr_set_level (old_level);
+}
+
+/* Returns up to PAGE_CNT pages from P's magazine to the pool.
+   Returns true if any pages were returned. */
+static bool
+magazine_drain (struct pool *p, size_t page_cnt)
+{
+  enum intr_level old_level = intr_disable ();
+  bool drained = p->magazine_cnt > 0;
+
+  while (page_cnt-- > 0 && p->magazine_cnt > 0)
+    {
+      void *page = p->magazine[--p->magazine_cnt];
+      pool_free (p, pg_no (page) - pg_no (p->base), 1);
+    }
+  if (drained)
+    p->drain_cnt++;
+  intr_set_level (old_level);
+
+  return drained;
+}
+
+/* Returns the smallest order whose blocks hold PAGE_CNT pages. */
+static int
+buddy_order (size_t page_cnt)
+{
+  int order = 0;
+  while (((size_t) 1 << order) < page_cnt)
+    order++;
+  return order;
+}
+
+/* Puts the free block of ORDER at page PAGE_IDX of P on its list.
+   Does not try to merge it. */
+static void
+buddy_push (struct pool *p, size_t page_idx, int order)
+{
+  struct list_elem *e = (struct list_elem *) (p->base + PGSIZE * page_idx);
+  list_push_front (&p->free_lists[order], e);
+  p->free_order[page_idx] = order;
+  p->free_cnt[order]++;
+}
+
+/* Takes the free block of ORDER at page PAGE_IDX of P off its
+   list. */
+static void
+buddy_remove (struct pool *p, size_t page_idx, int order)
+{
+  struct list_elem *e = (struct list_elem *) (p->base + PGSIZE * page_idx);
+  list_remove (e);
+  p->free_order[page_idx] = BUDDY_NOT_FREE;
+  p->free_cnt[order]--;
+}
+
+/* Frees the block of ORDER at page PAGE_IDX of P, merging it with
+   its buddy for as long as the buddy is free. */
+static void
+buddy_insert (struct pool *p, size_t page_idx, int order)
+{
+  size_t pool_pages = bitmap_size (p->used_map);
+
+  while (order < BUDDY_MAX_ORDER)
+    {
+      size_t buddy = page_idx ^ ((size_t) 1 << order);
+      if (buddy + ((size_t) 1 << order) > pool_pages
+          || p->free_order[buddy] != order)
+        break;
+
+      buddy_remove (p, buddy, order);
+      if (buddy < page_idx)
+        page_idx = buddy;
+      order++;
+      p->merge_cnt++;
+    }
+  buddy_push (p, page_idx, order);
+}
+
+/* Returns the PAGE_CNT pages starting at PAGE_IDX to P's buddy
+   lists, as the largest aligned blocks that cover them. */
+static void
+buddy_free_range (struct pool *p, size_t page_idx, size_t page_cnt)
+{
+  while (page_cnt > 0)
+    {
+      int order = 0;
+      while (order < BUDDY_MAX_ORDER
+             && page_idx % ((size_t) 2 << order) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+
+      buddy_insert (p, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Allocates PAGE_CNT contiguous pages from P's buddy lists and
+   returns the index of the first, or BITMAP_ERROR if no block is
+   large enough. */
+static size_t
+buddy_alloc (struct pool *p, size_t page_cnt)
+{
+  int order = buddy_order (page_cnt);
+  enum intr_level old_level;
+  size_t page_idx;
+  int k;
+
+  if (order > BUDDY_MAX_ORDER)
+    return BITMAP_ERROR;
+
+  old_level = intr_disable ();
+  for (k = order; k <= BUDDY_MAX_ORDER; k++)
+    if (!list_empty (&p->free_lists[k]))
+      break;
+  if (k > BUDDY_MAX_ORDER)
+    {
+      intr_set_level (old_level);
+      return BITMAP_ERROR;
+    }
+
+  page_idx = pg_no (list_front (&p->free_lists[k])) - pg_no (p->base);
+  buddy_remove (p, page_idx, k);
+
+  /* Split down to ORDER, keeping the lower half each time. */
+  while (k > order)
+    {
+      k--;
+      buddy_push (p, page_idx + ((size_t) 1 << k), k);
+      p->split_cnt++;
+    }
+
+  /* Give back the pages past PAGE_CNT. */
+  buddy_free_range (p, page_idx + page_cnt, ((size_t) 1 << order) - page_cnt);
+  bitmap_set_multiple (p->used_map, page_idx, page_cnt, true);
+  intr_set_level (old_level);
+
+  return page_idx;
+}
+
+/* Frees the PAGE_CNT pages starting at PAGE_IDX back to P's
+   buddy lists. */
+static void
+buddy_free (struct pool *p, size_t page_idx, size_t page_cnt)
+{
+  enum intr_level old_level = intr_disable ();
+
+  bitmap_set_multiple (p->used_map, page_idx, page_cnt, false);
+  buddy_free_range (p, page_idx, page_cnt);
+  intr_set_level (old_level);
+}
+
+/* Prints the statistics of pool P, named NAME. */
+static void
+print_pool_stats (const struct pool *p, const char *name)
+{
+  int order;
+
+  printf ("Palloc: %s pool: %zu magazine hits, %zu refills, %zu drains\n",
+          name, p->hit_cnt, p->refill_cnt, p->drain_cnt);
+  if (!palloc_buddy)
+    return;
+
+  printf ("Palloc: %s pool: %zu splits, %zu merges, free blocks by order:",
+          name, p->split_cnt, p->merge_cnt);
+  for (order = 0; order <= BUDDY_MAX_ORDER; order++)
+    printf (" %zu", p->free_cnt[order]);
+  printf ("\n");
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void)
+{
+  print_pool_stats (&kernel_pool, "kernel");
+  print_pool_stats (&user_pool, "user");
+}
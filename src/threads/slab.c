@@ -0,0 +1,246 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator.
+
+   Each cache hands out objects of a single size.  Objects come
+   from slabs, which are single pages from the page allocator
+   with a struct slab header at the start and the objects packed
+   right after it.  A slab's free objects form a singly linked
+   list threaded through the objects themselves.
+
+   A cache keeps its slabs on two lists: "partial" slabs have at
+   least one free object and "full" slabs have none.  Allocation
+   takes the first free object of the first partial slab, so it
+   never searches.  When a slab becomes entirely free it is kept
+   as the cache's spare, and a previous spare, if any, goes back
+   to the page allocator; that keeps a cache that hovers around a
+   slab boundary from allocating and freeing a page every time.
+
+   Unlike malloc(), a slab object is freed through its cache, but
+   the slab header is still found by rounding the object's
+   address down to a page boundary. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* A slab, at the start of its page. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct slab_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in partial or full list. */
+    struct free_obj *free;      /* First free object. */
+    size_t free_cnt;            /* Number of free objects. */
+  };
+
+/* A free object. */
+struct free_obj
+  {
+    struct free_obj *next;      /* Next free object in slab. */
+  };
+
+/* List of all caches, for statistics. */
+static struct list all_caches = LIST_INITIALIZER (all_caches);
+
+static struct slab *slab_create (struct slab_cache *);
+static struct slab *obj_to_slab (struct slab_cache *, void *);
+
+/* Initializes CACHE to hand out SIZE-byte objects, naming it
+   NAME in statistics.  If CTOR is nonnull, it is called on every
+   object slab_alloc() returns.  Allocates no memory, so it may be
+   called before the page allocator is initialized. */
+void
+slab_cache_init (struct slab_cache *cache, const char *name, size_t size,
+                 void (*ctor) (void *))
+{
+  enum intr_level old_level;
+
+  ASSERT (cache != NULL);
+  ASSERT (size > 0);
+
+  size = ROUND_UP (size, sizeof (void *));
+  if (size < sizeof (struct free_obj))
+    size = sizeof (struct free_obj);
+  ASSERT (size <= PGSIZE - sizeof (struct slab));
+
+  cache->name = name;
+  cache->obj_size = size;
+  cache->objs_per_slab = (PGSIZE - sizeof (struct slab)) / size;
+  cache->ctor = ctor;
+  lock_init (&cache->lock);
+  list_init (&cache->partial);
+  list_init (&cache->full);
+  cache->empty = NULL;
+  cache->slab_cnt = 0;
+  cache->obj_cnt = 0;
+
+  old_level = intr_disable ();
+  list_push_back (&all_caches, &cache->elem);
+  intr_set_level (old_level);
+}
+
+/* Allocates and returns an object from CACHE.
+   Returns a null pointer if memory is not available. */
+void *
+slab_alloc (struct slab_cache *cache)
+{
+  struct free_obj *obj;
+  struct slab *s;
+
+  lock_acquire (&cache->lock);
+  if (!list_empty (&cache->partial))
+    s = list_entry (list_front (&cache->partial), struct slab, elem);
+  else
+    {
+      if (cache->empty != NULL)
+        {
+          s = cache->empty;
+          cache->empty = NULL;
+        }
+      else
+        {
+          s = slab_create (cache);
+          if (s == NULL)
+            {
+              lock_release (&cache->lock);
+              return NULL;
+            }
+        }
+      list_push_front (&cache->partial, &s->elem);
+    }
+
+  obj = s->free;
+  s->free = obj->next;
+  if (--s->free_cnt == 0)
+    {
+      list_remove (&s->elem);
+      list_push_front (&cache->full, &s->elem);
+    }
+  cache->obj_cnt++;
+  lock_release (&cache->lock);
+
+  if (cache->ctor != NULL)
+    cache->ctor (obj);
+  return obj;
+}
+
+/* Returns OBJ, which must have been allocated from CACHE, to
+   CACHE.  A null OBJ is ignored. */
+void
+slab_free (struct slab_cache *cache, void *obj_)
+{
+  struct free_obj *obj = obj_;
+  struct slab *s;
+
+  if (obj == NULL)
+    return;
+
+  s = obj_to_slab (cache, obj);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs. */
+  memset (obj, 0xcc, cache->obj_size);
+#endif
+
+  lock_acquire (&cache->lock);
+  if (s->free_cnt++ == 0)
+    {
+      /* Was full. */
+      list_remove (&s->elem);
+      list_push_front (&cache->partial, &s->elem);
+    }
+  obj->next = s->free;
+  s->free = obj;
+  cache->obj_cnt--;
+
+  if (s->free_cnt == cache->objs_per_slab)
+    {
+      /* Entirely free.  Keep it as the spare. */
+      list_remove (&s->elem);
+      if (cache->empty != NULL)
+        {
+          palloc_free_page (cache->empty);
+          cache->slab_cnt--;
+        }
+      cache->empty = s;
+    }
+  lock_release (&cache->lock);
+}
+
+/* Prints the number of objects in use, the capacity, and the
+   memory utilization of each cache. */
+void
+slab_print_stats (void)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e))
+    {
+      struct slab_cache *c = list_entry (e, struct slab_cache, elem);
+      size_t capacity = c->slab_cnt * c->objs_per_slab;
+      size_t used_bytes = c->obj_cnt * c->obj_size;
+      size_t slab_bytes = c->slab_cnt * PGSIZE;
+
+      printf ("Slab: %s: %zu of %zu objects in use (%zu bytes each) "
+              "in %zu slabs, %zu%% utilized\n",
+              c->name, c->obj_cnt, capacity, c->obj_size, c->slab_cnt,
+              slab_bytes > 0 ? used_bytes * 100 / slab_bytes : 0);
+    }
+}
+
+/* Obtains a page for a new slab in CACHE and threads all of its
+   objects onto the slab's free list.  Returns the slab, or a
+   null pointer if no page is available. */
+static struct slab *
+slab_create (struct slab_cache *cache)
+{
+  struct slab *s = palloc_get_page (0);
+  uint8_t *first;
+  size_t i;
+
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = cache;
+  s->free = NULL;
+  s->free_cnt = cache->objs_per_slab;
+
+  /* Link back to front so that objects are handed out in
+     address order. */
+  first = (uint8_t *) (s + 1);
+  for (i = cache->objs_per_slab; i-- > 0; )
+    {
+      struct free_obj *obj = (struct free_obj *) (first + i * cache->obj_size);
+      obj->next = s->free;
+      s->free = obj;
+    }
+
+  cache->slab_cnt++;
+  return s;
+}
+
+/* Returns the slab that OBJ, which belongs to CACHE, is in. */
+static struct slab *
+obj_to_slab (struct slab_cache *cache, void *obj)
+{
+  struct slab *s = pg_round_down (obj);
+
+  /* Check that the slab is valid and belongs to CACHE. */
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == cache);
+
+  /* Check that the object is properly aligned for the cache. */
+  ASSERT ((pg_ofs (obj) - sizeof *s) % cache->obj_size == 0);
+
+  return s;
+}
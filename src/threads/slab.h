@@ -0,0 +1,35 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+/* A cache of equal-sized objects, carved out of whole pages
+   ("slabs").  Meant for small fixed-size structures that are
+   allocated and freed often, which would otherwise be rounded up
+   to the next power of two by malloc(). */
+struct slab_cache
+  {
+    const char *name;           /* Name, for statistics. */
+    size_t obj_size;            /* Size of each object in bytes. */
+    size_t objs_per_slab;       /* Number of objects in a slab. */
+    void (*ctor) (void *);      /* Run on each new object, or null. */
+
+    struct lock lock;           /* Protects the members below. */
+    struct list partial;        /* Slabs with at least one free object. */
+    struct list full;           /* Slabs with no free objects. */
+    struct slab *empty;         /* One entirely free slab kept around. */
+    size_t slab_cnt;            /* Slabs owned by this cache. */
+    size_t obj_cnt;             /* Objects in use. */
+
+    struct list_elem elem;      /* Element in list of all caches. */
+  };
+
+void slab_cache_init (struct slab_cache *, const char *name, size_t size,
+                      void (*ctor) (void *));
+void *slab_alloc (struct slab_cache *);
+void slab_free (struct slab_cache *, void *);
+void slab_print_stats (void);
+
+#endif /* threads/slab.h */
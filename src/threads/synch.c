@@ -70,8 +70,10 @@ sema_down (struct semaphore *sema)
   {
 	  // 우선순위 순서대로 삽입
       list_insert_ordered (&sema->waiters, &thread_current ()->elem, priority_more, NULL);
+	  thread_current ()->waiting_sema = sema;
 	  thread_block ();
   }
+  thread_current ()->waiting_sema = NULL;
   sema->value--;
   intr_set_level (old_level);
 }
@@ -116,8 +118,7 @@ sema_up (struct semaphore *sema)
   old_level = intr_disable ();
   if (!list_empty (&sema->waiters))
   {
-	  // 우선순위 순서대로 삽입하였으나, priority change / donation이 발생했을 가능성이 있어 빼내기 전에 정렬
-	list_sort(&sema->waiters, priority_more, NULL); 
+	  // priority change / donation이 발생하면 reposition_thread가 순서를 유지하므로 맨 앞이 최고 우선순위
     thread_unblock (list_entry (list_pop_front (&sema->waiters),
                                 struct thread, elem));
   }
@@ -188,6 +189,7 @@ lock_init (struct lock *lock)
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+  lock->max_priority = -1;
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -206,18 +208,21 @@ lock_acquire (struct lock *lock)
   ASSERT (!lock_held_by_current_thread (lock));
 
   struct thread *t = thread_current();
+  enum intr_level old_level = intr_disable ();
   if(lock->holder)
   {
 	  // lock이 걸려 있는 경우, thread가 막힌 lock 변수를 설정하고
-	  // lock holder의 donator 리스트에 현재 thread를 넣은 후 donate 시도
+	  // lock과 그 holder를 따라 priority donate
 	  t->waiting_lock = lock;
-	  list_insert_ordered(&lock->holder->donator, &t->donator_elem, priority_more, NULL);
 	  donate_priority(t);
   }
 
   sema_down (&lock->semaphore);
   t->waiting_lock = NULL;
-  lock->holder = thread_current ();
+  lock->holder = t;
+  // 남아 있는 waiter들의 priority를 lock heap에 반영
+  hold_lock(t, lock);
+  intr_set_level (old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -229,14 +234,20 @@ lock_acquire (struct lock *lock)
 bool
 lock_try_acquire (struct lock *lock)
 {
+  enum intr_level old_level;
   bool success;
 
   ASSERT (lock != NULL);
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      lock->holder = thread_current ();
+      hold_lock (lock->holder, lock);
+    }
+  intr_set_level (old_level);
   return success;
 }
 
@@ -251,13 +262,15 @@ lock_release (struct lock *lock)
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  enum intr_level old_level = intr_disable ();
   lock->holder = NULL;
 
-  // lock이 release되었으므로 해당 lock을 기다리던 thread들을 삭제하고
-  // thread의 priority를 donation 받기 전으로 돌림
+  // lock이 release되었으므로 lock heap에서 해당 lock을 빼고
+  // 나머지 lock들에서 donation 받은 priority로 다시 계산
   struct thread *t = thread_current();
   clear_waiting(t, lock);
   restore_priority(t);
+  intr_set_level (old_level);
 
   sema_up (&lock->semaphore);
 }
@@ -364,9 +377,10 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   if (!list_empty (&cond->waiters))
   {
 	// cond_wait에서는 sema_down 전에 waiters에 semaphore_elem을 넣기 때문에, 넣는 시점에 thread priority로 정렬 불가능함
-	list_sort(&cond->waiters, priority_more_semaphore_elem, NULL); 
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+	// 전체를 정렬하지 않고 한 번 훑어서 가장 높은 우선순위(같으면 먼저 들어온 것)를 꺼냄
+	struct list_elem *e = list_min (&cond->waiters, priority_more_semaphore_elem, NULL);
+	list_remove (e);
+    sema_up (&list_entry (e, struct semaphore_elem, elem)->semaphore);
   }
 }
 
@@ -385,3 +399,176 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Initializes RW as unlocked. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->writer);
+  rw->readers = 0;
+  rw->writer_waiting = false;
+  sema_init (&rw->drained, 0);
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or
+   is waiting for it.  While sleeping, the current thread donates
+   its priority to that writer.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_read_acquire (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  lock_acquire (&rw->writer);
+  old_level = intr_disable ();
+  rw->readers++;
+  intr_set_level (old_level);
+  lock_release (&rw->writer);
+}
+
+/* Releases RW, which the current thread must hold for reading.
+   The last reader out wakes up a waiting writer. */
+void
+rwlock_read_release (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+
+  old_level = intr_disable ();
+  ASSERT (rw->readers > 0);
+  if (--rw->readers == 0 && rw->writer_waiting)
+    {
+      rw->writer_waiting = false;
+      sema_up (&rw->drained);
+    }
+  intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until the previous writer
+   and all active readers are gone.  Readers arriving after us
+   wait until we release RW.
+
+   Readers that are already inside cannot be identified, so they
+   do not receive our priority; only the writer does.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_write_acquire (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  lock_acquire (&rw->writer);
+  old_level = intr_disable ();
+  while (rw->readers > 0)
+    {
+      rw->writer_waiting = true;
+      sema_down (&rw->drained);
+    }
+  intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread must hold for writing. */
+void
+rwlock_write_release (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_for_write (rw));
+
+  lock_release (&rw->writer);
+}
+
+/* Returns true if the current thread holds RW for writing. */
+bool
+rwlock_held_for_write (const struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return lock_held_by_current_thread (&rw->writer);
+}
+
+/* Initializes SL. */
+void
+seqlock_init (struct seqlock *sl)
+{
+  ASSERT (sl != NULL);
+
+  sl->sequence = 0;
+  lock_init (&sl->writer);
+}
+
+/* Starts a read of the data protected by SL and returns the
+   sequence number to pass to seqlock_read_retry().  If a thread
+   was preempted in the middle of a write, sleeps on the writer
+   lock (donating our priority) until that write completes,
+   rather than spinning.
+
+   May be called from an interrupt handler only if every writer
+   runs with interrupts off, because then no write can be seen
+   in progress. */
+unsigned
+seqlock_read_begin (struct seqlock *sl)
+{
+  unsigned start;
+
+  for (;;)
+    {
+      start = sl->sequence;
+      barrier ();
+      if (start % 2 == 0)
+        return start;
+
+      ASSERT (!intr_context ());
+      lock_acquire (&sl->writer);
+      lock_release (&sl->writer);
+    }
+}
+
+/* Returns true if a write to SL overlapped the read that began
+   with START, in which case the read must be repeated. */
+bool
+seqlock_read_retry (const struct seqlock *sl, unsigned start)
+{
+  barrier ();
+  return sl->sequence != start;
+}
+
+/* Starts a write to the data protected by SL.  Outside of
+   interrupt context, waits for other writers first. */
+void
+seqlock_write_begin (struct seqlock *sl)
+{
+  ASSERT (sl != NULL);
+  ASSERT (!intr_context () || sl->writer.holder == NULL);
+
+  if (!intr_context ())
+    lock_acquire (&sl->writer);
+
+  sl->sequence++;
+  barrier ();
+}
+
+/* Ends a write started with seqlock_write_begin(). */
+void
+seqlock_write_end (struct seqlock *sl)
+{
+  ASSERT (sl != NULL);
+  ASSERT (sl->sequence % 2 == 1);
+
+  barrier ();
+  sl->sequence++;
+
+  if (!intr_context ())
+    lock_release (&sl->writer);
+}
@@ -1,6 +1,7 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
 
@@ -22,6 +23,10 @@ struct lock
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+
+    /* Priority donation, see donate_priority() in thread.c. */
+    int max_priority;           /* Highest waiter priority, -1 if none. */
+    struct heap_elem heap_elem; /* Element in holder's held_locks. */
   };
 
 void lock_init (struct lock *);
@@ -41,6 +46,39 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Reader-writer lock.  Any number of readers or a single writer.
+   A waiting writer holds WRITER, so new readers queue up behind
+   it (writer preference) and donate their priority to it. */
+struct rwlock
+  {
+    struct lock writer;         /* Held by the active or next writer. */
+    unsigned readers;           /* Number of active readers. */
+    bool writer_waiting;        /* Writer waiting for readers to drain. */
+    struct semaphore drained;   /* Upped by the last reader to leave. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_read_acquire (struct rwlock *);
+void rwlock_read_release (struct rwlock *);
+void rwlock_write_acquire (struct rwlock *);
+void rwlock_write_release (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+
+/* Sequence lock.  Readers never block writers; they retry if a
+   write overlapped their read.  Writers are serialized by WRITER,
+   except in an interrupt handler, which must be the only writer. */
+struct seqlock
+  {
+    unsigned sequence;          /* Odd while a write is in progress. */
+    struct lock writer;         /* Serializes sleeping writers. */
+  };
+
+void seqlock_init (struct seqlock *);
+unsigned seqlock_read_begin (struct seqlock *);
+bool seqlock_read_retry (const struct seqlock *, unsigned start);
+void seqlock_write_begin (struct seqlock *);
+void seqlock_write_end (struct seqlock *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
@@ -10,6 +10,7 @@
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -43,6 +44,9 @@ static struct thread *initial_thread;
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
+/* Cache of struct child, one per created thread. */
+static struct slab_cache child_cache;
+
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame 
   {
@@ -57,7 +61,6 @@ static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
 
 /* Scheduling. */
-#define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 
 /* If false (default), use round-robin scheduler.
@@ -71,6 +74,9 @@ static void idle (void *aux UNUSED);
 static struct thread *running_thread (void);
 static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
+static int default_time_slice (enum sched_class);
+static bool should_preempt (struct thread *cur, struct thread *ready);
+static bool wake_sleepers (struct thread *cur);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
@@ -97,6 +103,7 @@ thread_init (void)
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
+  slab_cache_init (&child_cache, "child", sizeof (struct child), NULL);
   list_init (&ready_list);
   list_init (&all_list);
   list_init (&wait_list);
@@ -142,11 +149,42 @@ thread_tick (void)
   else
     kernel_ticks++;
 
-  /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  /* Wake up sleepers whose time is up, even if T never yields. */
+  if (wake_sleepers (t))
+    intr_yield_on_return ();
+
+  /* Enforce preemption.  FIFO threads have no quantum. */
+  if (t->sched_class != SCHED_FIFO && ++thread_ticks >= (unsigned) t->time_slice)
     intr_yield_on_return ();
 }
 
+/* wait_list에 있으면 첫 원소 검사(이미 정렬됨) 후 sleep 시간 지났다면 unblock.
+   unblock() 에서 ready_list로 넣게 됨.  runs in the timer interrupt with
+   interrupts off; returns true if a woken thread should preempt CUR */
+static bool
+wake_sleepers(struct thread *cur)
+{
+	int64_t now = timer_ticks();
+	bool preempt = false;
+
+	while( ! list_empty(&wait_list))
+	{
+		struct thread *t = list_entry(list_front(&wait_list), struct thread, elem);
+		if(now - t->wait_start < t->wait_length)
+			break;
+
+		list_pop_front(&wait_list);
+		t->wait_flag = 0;
+		t->wait_start = 0;
+		t->wait_length = 0;
+
+		thread_unblock(t);
+		if(cur == idle_thread || should_preempt(cur, t))
+			preempt = true;
+	}
+	return preempt;
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void) 
@@ -173,6 +211,19 @@ thread_print_stats (void)
 tid_t
 thread_create (const char *name, int priority,
                thread_func *function, void *aux) 
+{
+  return thread_create_sched (name, priority, SCHED_RR, 0, function, aux);
+}
+
+/* Like thread_create(), but the new thread runs in scheduling
+   class CLASS with a quantum of TIME_SLICE ticks.  A TIME_SLICE
+   of 0 selects the class default.  TIME_SLICE is ignored for
+   SCHED_FIFO threads, which are only preempted by higher
+   priority threads. */
+tid_t
+thread_create_sched (const char *name, int priority,
+                     enum sched_class class, int time_slice,
+                     thread_func *function, void *aux)
 {
   struct thread *t;
   struct kernel_thread_frame *kf;
@@ -181,6 +232,8 @@ thread_create (const char *name, int priority,
   tid_t tid;
 
   ASSERT (function != NULL);
+  ASSERT (class < SCHED_CLASS_CNT);
+  ASSERT (time_slice >= 0);
 
   /* Allocate thread. */
   t = palloc_get_page (PAL_ZERO);
@@ -190,6 +243,8 @@ thread_create (const char *name, int priority,
   /* Initialize thread. */
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
+  t->sched_class = class;
+  t->time_slice = time_slice > 0 ? time_slice : default_time_slice (class);
 
   /* Stack frame for kernel_thread(). */
   kf = alloc_frame (t, sizeof *kf);
@@ -210,19 +265,25 @@ thread_create (const char *name, int priority,
   list_init(&t->file_list);
   t->current_max_fd = 10;
 
+  /* User Program : Shared memory mappings */
+  list_init(&t->shm_maps);
+
   /* User Program : Init executing file */
   t->executing_file = NULL;
 
   /* User Program : Add child */
-  t->myself = malloc(sizeof(struct child));
+  t->myself = slab_alloc(&child_cache);
   t->myself->tid = tid;
   t->myself->self = t;
   t->myself->parent = thread_current();
   t->myself->parent_is_waiting = false;
   t->myself->exit_status = 0;
   t->myself->is_zombie = false;
+  t->myself->is_process = false;
+  sema_init(&t->myself->exited, 0);
   /* User Program : Set loading status */
   t->myself->load_status = 0;
+  sema_init(&t->myself->loaded, 0);
   list_push_back(&thread_current()->child_list, &t->myself->child_elem);
 
   /* File System : Set directory */
@@ -316,6 +377,22 @@ get_child (tid_t tid)
   return NULL;
 }
 
+/* Frees C, which must have been removed from its parent's
+   child_list. */
+void
+child_free (struct child *c)
+{
+  slab_free (&child_cache, c);
+}
+
+/* Returns the main thread of T's process.  User threads share
+   its page directory, open files and working directory. */
+struct thread *
+thread_leader (struct thread *t)
+{
+  return t->leader != NULL ? t->leader : t;
+}
+
 /* Returns the running thread's tid. */
 tid_t
 thread_tid (void) 
@@ -333,6 +410,7 @@ thread_exit (void)
 #ifdef USERPROG
   process_exit ();
 #endif
+  malloc_thread_exit ();
 
   /* Remove thread from all threads list, set our status to dying,
      and schedule another process.  That process will destroy us
@@ -415,6 +493,23 @@ thread_sleep(int64_t ticks)
 	intr_set_level(old_level);
 }
 
+/* wakes up T, blocked in thread_block() or thread_sleep(), before its
+   sleep time is up.  interrupts must be off */
+void
+thread_wakeup(struct thread *t)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if(t->wait_flag)
+	{
+		list_remove(&t->elem);
+		t->wait_flag = 0;
+		t->wait_start = 0;
+		t->wait_length = 0;
+	}
+	thread_unblock(t);
+}
+
 /* yield current thread if it does not have highest priority */
 void
 thread_check_ready()
@@ -425,59 +520,124 @@ thread_check_ready()
 	struct thread *cur = thread_current();
 	struct thread *r = list_entry(list_front(&ready_list), struct thread, elem);
 
-	if( ! intr_context() && cur->priority <= r->priority)
+	if( ! intr_context() && should_preempt(cur, r))
 		thread_yield();
 }
 
-/* donate priority to lock holder thread
- * also donate to nested lock holder thread (< 8 depth, as manual) */
+/* true if running thread CUR must give way to READY.
+   Round-robin threads also yield to equal priority; FIFO and batch
+   threads keep the CPU until a strictly higher priority shows up */
+static bool
+should_preempt (struct thread *cur, struct thread *ready)
+{
+	if(cur->sched_class == SCHED_RR)
+		return cur->priority <= ready->priority;
+	return cur->priority < ready->priority;
+}
+
+/* prj1 : every thread keeps the locks it holds in a pairing heap
+ * ordered by lock->max_priority, the highest priority waiting on
+ * that lock.  the top is therefore the largest donation, so
+ * a donation is O(1) per hop and a release is O(log n) amortized */
+static bool
+lock_more_priority(const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED)
+{
+	return heap_entry(a, struct lock, heap_elem)->max_priority
+		> heap_entry(b, struct lock, heap_elem)->max_priority;
+}
+
+/* move T to its new place in whichever priority queue holds it */
+static void
+reposition_thread(struct thread *t)
+{
+	if(t == idle_thread)
+		return;
+
+	// 리스트의 나머지는 정렬되어 있으므로 T만 제자리로 옮기면 됨
+	if(t->status == THREAD_READY
+	   || (t->status == THREAD_BLOCKED && t->waiting_sema != NULL))
+		list_reposition(&t->elem, priority_more, NULL);
+}
+
+/* donate priority of T, which is going to wait t->waiting_lock,
+ * to the lock and its holder thread
+ * also donate to nested lock holder thread (< 8 depth, as manual)
+ * must be called with interrupts off */
 void donate_priority(struct thread *t)
 {
 	struct lock *l = t->waiting_lock;
 	int depth = 0;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
 	while(l)
 	{
 		depth++;
 		if(depth > 8)
 			break;
+		// holder는 항상 max_priority 이상이므로 더 올라갈 것이 없음
+		if(l->max_priority >= t->priority)
+			break;
+
+		l->max_priority = t->priority;
 		if( ! l->holder)
 			break;
-		if(l->holder->priority >= t->priority)
+
+		struct thread *h = l->holder;
+		heap_promote(&h->held_locks, &l->heap_elem);
+		if(h->priority >= t->priority)
 			break;
 
-		l->holder->priority = t->priority;
-		t = l->holder;
+		h->priority = t->priority;
+		reposition_thread(h);
+		t = h;
 		l = t->waiting_lock;
 	}
 }
 
+/* T now holds L : add L to T's lock heap and take over the
+ * donations of the threads still waiting for L
+ * must be called with interrupts off */
+void hold_lock(struct thread *t, struct lock *l)
+{
+	struct list *waiters = &l->semaphore.waiters;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	// waiters는 priority 순으로 정렬되어 있음
+	if(list_empty(waiters))
+		l->max_priority = -1;
+	else
+		l->max_priority = list_entry(list_front(waiters), struct thread, elem)->priority;
+
+	heap_push(&t->held_locks, &l->heap_elem);
+	if(t->priority < l->max_priority)
+		t->priority = l->max_priority;
+}
+
 /* restore priority to before donation
  * but if there is higher priority in donated thread(that means more than one thread donated)
  * maintain that priority */
 void restore_priority(struct thread *t)
 {
-	if(t->priority != t->original_priority)
-		t->priority = t->original_priority;
+	t->priority = t->original_priority;
 
-	if( ! list_empty(&t->donator))
+	if(!heap_empty(&t->held_locks))
 	{
-		struct thread *d = list_entry(list_front(&t->donator), struct thread, donator_elem);
-		if(t->priority < d->priority)
-			t->priority = d->priority;
+		struct lock *top = heap_entry(heap_top(&t->held_locks), struct lock, heap_elem);
+		if(t->priority < top->max_priority)
+			t->priority = top->max_priority;
 	}
 }
 
-/* clear donated threads that waiting the lock
- * called when that lock was released */
+/* drop donations that came through the lock WL
+ * called when that lock was released
+ * must be called with interrupts off */
 void clear_waiting(struct thread *t, struct lock *wl)
 {
-	struct list_elem *e;
-	for(e = list_begin(&t->donator); e != list_end(&t->donator); e = list_next(e))
-	{
-		struct thread *w = list_entry(e, struct thread, donator_elem);
-		if(w->waiting_lock == wl)
-			list_remove(e);
-	}
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	heap_remove(&t->held_locks, &wl->heap_elem);
 }
 
 /* Invoke function 'func' on all threads, passing along 'aux'.
@@ -501,10 +661,12 @@ thread_foreach (thread_action_func *func, void *aux)
 void
 thread_set_priority (int new_priority) 
 {
+  enum intr_level old_level = intr_disable ();
   thread_current ()->original_priority = new_priority;
   
   // new_priority로 설정을 시도하나, donate 받은 게 있는 경우 일단 받은 값을 가지도록 
   restore_priority(thread_current());
+  intr_set_level (old_level);
 
   thread_check_ready();
 }
@@ -516,6 +678,43 @@ thread_get_priority (void)
   return thread_current ()->priority;
 }
 
+/* Moves the current thread to scheduling class CLASS with a
+   quantum of TIME_SLICE ticks (0 selects the class default).
+   Returns false if CLASS or TIME_SLICE is out of range. */
+bool
+thread_set_sched_class (enum sched_class class, int time_slice)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  if (class >= SCHED_CLASS_CNT || time_slice < 0
+      || time_slice > MAX_TIME_SLICE)
+    return false;
+
+  old_level = intr_disable ();
+  cur->sched_class = class;
+  cur->time_slice = time_slice > 0 ? time_slice : default_time_slice (class);
+  intr_set_level (old_level);
+
+  /* Leaving SCHED_FIFO may expose us to an equal priority thread. */
+  thread_check_ready ();
+  return true;
+}
+
+/* Returns the current thread's scheduling class. */
+enum sched_class
+thread_get_sched_class (void)
+{
+  return thread_current ()->sched_class;
+}
+
+/* Returns the quantum used by CLASS when none is given. */
+static int
+default_time_slice (enum sched_class class)
+{
+  return class == SCHED_BATCH ? BATCH_TIME_SLICE : TIME_SLICE;
+}
+
 /* Sets the current thread's nice value to NICE. */
 void
 thread_set_nice (int nice UNUSED) 
@@ -633,19 +832,32 @@ init_thread (struct thread *t, const char *name, int priority)
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
   t->priority = priority;
+  t->sched_class = SCHED_RR;
+  t->time_slice = TIME_SLICE;
   t->magic = THREAD_MAGIC;
 
   // for priority donation
   t->original_priority = priority;
-  list_init(&t->donator);
+  heap_init (&t->held_locks, lock_more_priority, NULL);
   t->waiting_lock = NULL;
+  t->waiting_sema = NULL;
 
   // for user program
   list_init(&t->child_list);
+  list_init(&t->exited_children);
+  sema_init(&t->child_exited, 0);
+  wait_queue_init(&t->child_queue);
+  t->child_cnt = 0;
 
   // for file system
   t->directory = NULL;
 
+  // for user threads
+  t->leader = NULL;
+  sema_init(&t->uthreads_done, 0);
+  wait_queue_init(&t->exit_queue);
+  rwlock_init(&t->user_mem);
+
   old_level = intr_disable ();
   list_push_back (&all_list, &t->allelem);
   intr_set_level (old_level);
@@ -672,24 +884,6 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void) 
 {
-	// wait_list에 있으면 첫 원소 검사(이미 정렬됨) 후 sleep 시간 지났다면 unblock
-	// unblock() 에서 ready_list로 넣게 됨
-	while( ! list_empty(&wait_list))
-	{
-		struct thread *t = list_entry(list_front(&wait_list), struct thread, elem);
-		if(timer_elapsed(t->wait_start) >= t->wait_length)
-		{
-			t = list_entry(list_pop_front(&wait_list), struct thread, elem);
-			t->wait_flag = 0;
-			t->wait_start = 0;
-			t->wait_length = 0;
-
-			thread_unblock(t);
-		}
-		else
-			break;
-	}
-
   if (list_empty (&ready_list))
     return idle_thread;
   else
@@ -2,8 +2,13 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <heap.h>
 #include <list.h>
+#include <sched.h>
 #include <stdint.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/waitq.h"
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -25,6 +30,11 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Time slices, in timer ticks. */
+#define TIME_SLICE 4                    /* Default SCHED_RR quantum. */
+#define BATCH_TIME_SLICE 32             /* Default SCHED_BATCH quantum. */
+#define MAX_TIME_SLICE 100              /* Longest quantum. */
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -89,6 +99,8 @@ struct thread
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
     int priority;                       /* Priority. */
+    enum sched_class sched_class;       /* Scheduling class. */
+    int time_slice;                     /* Ticks to run before preemption. */
     struct list_elem allelem;           /* List element for all threads list. */
 
     /* Shared between thread.c and synch.c. */
@@ -102,21 +114,42 @@ struct thread
 	// prj1 priority donation
 	int original_priority;				/* prj1 : priority before donation */
 	struct lock *waiting_lock;			/* prj1 : lock that this thread is waiting */
-	struct list donator;				/* prj1 : list of thread that donated this priority */
-	struct list_elem donator_elem;		/* prj1 : list elem of donator */
+	struct semaphore *waiting_sema;		/* prj1 : semaphore that this thread is blocked on */
+	struct heap held_locks;				/* prj1 : held locks, highest waiter priority on top */
 
 	// prj2 user program
 	struct list file_list;				/* prj2 : files opened in this process */
 	int current_max_fd;					/* prj2 : increment when new file opened */
+	struct list shm_maps;				/* shared memory mappings of this process, by address */
 
 	struct list child_list;				/* prj2 : child process list(struct child) - To store child process */
+	struct list exited_children;		/* prj2 : started child processes that exited, not yet reaped */
+	struct semaphore child_exited;		/* prj2 : upped once for each of exited_children */
+	struct wait_queue child_queue;		/* prj2 : woken whenever a child dies */
+	int child_cnt;						/* prj2 : started child processes not yet reaped */
 	struct child *myself;				/* prj2 : this goes to parent's child_list */
+	bool is_process;					/* prj2 : runs a user program, false for kernel threads */
 	
 	struct file *executing_file;		/* prj2 : the file that this process are executing
 										   		  must not be written when executing */
 	// prj4 file system
 	struct dir *directory; 				/* prj4 : current working directory */
 
+	// user threads, sharing pagedir, file_list and directory of the leader
+	struct thread *leader;				/* main thread of this process, NULL if it is this one */
+	int uthread_slot;					/* user stack slot of this user thread */
+	int uthread_cnt;					/* leader : user threads still running */
+	uint32_t uthread_slots;				/* leader : bitmap of user stack slots in use */
+	bool process_exiting;				/* leader : process is going down, user threads must exit */
+	struct semaphore uthreads_done;		/* leader : upped when the last user thread is gone */
+	struct wait_queue exit_queue;		/* leader : woken when process_exiting is set */
+	struct rwlock user_mem;				/* leader : read while the kernel copies through user
+										   		  addresses, written while pages are unmapped */
+
+    /* Owned by threads/malloc.c. */
+    void *malloc_cache[MALLOC_CACHE_CLASSES];         /* Free small blocks. */
+    uint8_t malloc_cache_cnt[MALLOC_CACHE_CLASSES];   /* Blocks in each list. */
+
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
@@ -130,17 +163,20 @@ struct thread
 struct child
 {
 	struct list_elem child_elem;
+	struct list_elem exit_elem;		/* in parent's exited_children, for started processes */
 	tid_t tid;
 	struct thread *self;			/* this process */
 	struct thread *parent;			/* parent process */
 	int exit_status;				/* exit status, -1 when error */
-	bool parent_is_waiting;			/* if this flag is set, wake up parent */
+	bool parent_is_waiting;			/* process_wait() has been called for this child */
 	bool is_zombie;					/* child process is dead - true when terminated */
-	int load_status;				/* filesys_open test is not enough,
-									   so we will not return exec until this is confirmed 
+	bool is_process;				/* a process started by exec, spawn or fork, not a thread */
+	int load_status;				/* exec does not return until this is confirmed
 												  0 is loading
 												  1 is success
 												  -1 is fail*/
+	struct semaphore loaded;		/* upped by the child once load_status is set */
+	struct semaphore exited;		/* upped by the child once it is a zombie */
 };
 
 /* If false (default), use round-robin scheduler.
@@ -156,12 +192,17 @@ void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
+tid_t thread_create_sched (const char *name, int priority,
+                           enum sched_class, int time_slice,
+                           thread_func *, void *);
 
 void thread_block (void);
 void thread_unblock (struct thread *);
 
 struct thread *thread_current (void);
 struct child *get_child (tid_t tid);	// prj2 New function
+void child_free (struct child *);
+struct thread *thread_leader (struct thread *);
 tid_t thread_tid (void);
 const char *thread_name (void);
 
@@ -174,11 +215,13 @@ void thread_yield (void);
 /////////////////////////
 //
 void thread_sleep(int64_t ticks);
+void thread_wakeup(struct thread *t);
 bool sleep_time_less(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED);
 bool priority_more(const struct list_elem *a, const struct list_elem *b, void *aus UNUSED);
 
 void thread_check_ready(void);
 void donate_priority(struct thread *t);
+void hold_lock(struct thread *t, struct lock *l);
 void clear_waiting(struct thread *t, struct lock *waiting_lock);
 void restore_priority(struct thread *t);
 
@@ -191,6 +234,9 @@ void thread_foreach (thread_action_func *, void *);
 int thread_get_priority (void);
 void thread_set_priority (int);
 
+bool thread_set_sched_class (enum sched_class, int time_slice);
+enum sched_class thread_get_sched_class (void);
+
 int thread_get_nice (void);
 void thread_set_nice (int);
 int thread_get_recent_cpu (void);
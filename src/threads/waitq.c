@@ -0,0 +1,100 @@
+#include "threads/waitq.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* Initializes wait queue Q as empty. */
+void
+wait_queue_init (struct wait_queue *q)
+{
+  list_init (&q->entries);
+}
+
+/* Makes W wait on Q, through entry E, until wait_queue_remove()
+   is called for E. */
+void
+wait_queue_add (struct wait_queue *q, struct wait_entry *e, struct waiter *w)
+{
+  enum intr_level old_level;
+
+  e->waiter = w;
+  old_level = intr_disable ();
+  list_push_back (&q->entries, &e->elem);
+  intr_set_level (old_level);
+}
+
+/* Removes entry E from the wait queue it was added to. */
+void
+wait_queue_remove (struct wait_entry *e)
+{
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  list_remove (&e->elem);
+  intr_set_level (old_level);
+}
+
+/* Wakes every waiter on Q. */
+void
+wait_queue_wake (struct wait_queue *q)
+{
+  enum intr_level old_level;
+  struct list_elem *e;
+
+  old_level = intr_disable ();
+  for (e = list_begin (&q->entries); e != list_end (&q->entries);
+       e = list_next (e))
+    {
+      struct waiter *w = list_entry (e, struct wait_entry, elem)->waiter;
+
+      w->woken = true;
+
+      /* After a timeout the thread is ready again but has not
+         run yet to clear SLEEPING. */
+      if (w->sleeping && w->thread->status == THREAD_BLOCKED)
+        {
+          w->sleeping = false;
+          thread_wakeup (w->thread);
+        }
+    }
+  intr_set_level (old_level);
+}
+
+/* Initializes W for the running thread. */
+void
+waiter_init (struct waiter *w)
+{
+  w->thread = thread_current ();
+  w->woken = false;
+  w->sleeping = false;
+}
+
+/* Sleeps until one of the wait queues W waits on is woken, for at
+   most TICKS timer ticks if TICKS is positive, or for good if it
+   is negative.  Returns immediately if TICKS is 0 or a queue was
+   woken since the last call.  Returns true if a queue was woken,
+   false on timeout. */
+bool
+waiter_sleep (struct waiter *w, int64_t ticks)
+{
+  enum intr_level old_level;
+  bool woken;
+
+  ASSERT (!intr_context ());
+  ASSERT (w->thread == thread_current ());
+
+  old_level = intr_disable ();
+  if (!w->woken && ticks != 0)
+    {
+      w->sleeping = true;
+      if (ticks > 0)
+        thread_sleep (ticks);
+      else
+        thread_block ();
+      w->sleeping = false;
+    }
+  woken = w->woken;
+  w->woken = false;
+  intr_set_level (old_level);
+  return woken;
+}
@@ -0,0 +1,49 @@
+#ifndef THREADS_WAITQ_H
+#define THREADS_WAITQ_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Wait queues.
+
+   A wait queue belongs to something a thread can wait on, such
+   as a buffer, and is woken whenever its state changes.  Unlike
+   a semaphore or condition variable, one thread can wait on many
+   wait queues at once, which is what poll() needs.
+
+   wait_queue_wake() may be called from an external interrupt
+   handler.  The other functions must be called from a kernel
+   thread. */
+
+/* A thread waiting on wait queues. */
+struct waiter
+  {
+    struct thread *thread;      /* Waiting thread. */
+    bool woken;                 /* A queue was woken since last sleep. */
+    bool sleeping;              /* Blocked in waiter_sleep(). */
+  };
+
+/* Links a waiter into one wait queue. */
+struct wait_entry
+  {
+    struct list_elem elem;      /* Element in the queue. */
+    struct waiter *waiter;      /* Waiter. */
+  };
+
+/* A wait queue. */
+struct wait_queue
+  {
+    struct list entries;        /* List of struct wait_entry. */
+  };
+
+void wait_queue_init (struct wait_queue *);
+void wait_queue_add (struct wait_queue *, struct wait_entry *,
+                     struct waiter *);
+void wait_queue_remove (struct wait_entry *);
+void wait_queue_wake (struct wait_queue *);
+
+void waiter_init (struct waiter *);
+bool waiter_sleep (struct waiter *, int64_t ticks);
+
+#endif /* threads/waitq.h */
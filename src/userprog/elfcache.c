@@ -0,0 +1,244 @@
+#include "userprog/elfcache.h"
+#include <debug.h>
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "userprog/pagedir.h"
+
+/* Cache of executable images.
+
+   Repeated exec() of the same program maps the pages of the
+   cached image instead of parsing the ELF headers and reading
+   every segment from disk again.  Processes share the image's
+   frames, writable ones copy-on-write.
+
+   Images are keyed by inode.  A cached image holds its inode
+   open, so that opening the file again yields the same struct
+   inode.  An image goes stale once its file is written, and is
+   dropped when it is next looked up.  The image of a file is
+   dropped as soon as the file is removed, so that the inode and
+   its disk blocks are freed once the last process using the file
+   closes it.
+
+   Cached images hold frames from the user pool.  When they would
+   hold more than ELFCACHE_FRAMES, the least recently used images
+   are evicted, and the whole cache is flushed when the user pool
+   runs out. */
+#define ELFCACHE_FRAMES 128     /* Most frames held by the cache. */
+
+static struct list images;      /* Most recently used first. */
+static size_t cached_frames;    /* Frames of the images in IMAGES. */
+static struct lock cache_lock;
+
+static void image_free (struct elf_image *);
+
+/* Initializes the executable image cache. */
+void
+elfcache_init (void)
+{
+  list_init (&images);
+  lock_init (&cache_lock);
+}
+
+/* Returns a new, empty image of INODE holding one reference, for
+   the caller, or a null pointer if memory is exhausted. */
+struct elf_image *
+elf_image_create (struct inode *inode)
+{
+  struct elf_image *image = malloc (sizeof *image);
+  if (image != NULL)
+    {
+      image->inode = inode_reopen (inode);
+      image->write_cnt = inode->write_cnt;
+      image->ref_cnt = 1;
+      image->entry = NULL;
+      image->page_cnt = 0;
+      image->frame_cnt = 0;
+      image->pages = NULL;
+    }
+  return image;
+}
+
+/* Appends a page at UPAGE to IMAGE.  Its contents are in KPAGE,
+   a page from the user pool that IMAGE takes over, or the page
+   is zeroed if KPAGE is null.  Returns false if memory is
+   exhausted. */
+bool
+elf_image_add_page (struct elf_image *image, void *upage, void *kpage,
+                    bool writable)
+{
+  struct image_page *p;
+  size_t cnt = image->page_cnt;
+
+  /* Double the array whenever CNT reaches a power of 2. */
+  if ((cnt & (cnt - 1)) == 0)
+    {
+      p = realloc (image->pages, (cnt != 0 ? 2 * cnt : 1) * sizeof *p);
+      if (p == NULL)
+        return false;
+      image->pages = p;
+    }
+
+  p = &image->pages[image->page_cnt++];
+  if (kpage != NULL)
+    image->frame_cnt++;
+  p->upage = upage;
+  p->kpage = kpage;
+  p->writable = writable;
+  return true;
+}
+
+/* Drops a reference to IMAGE, freeing it when that was the
+   last. */
+void
+elf_image_release (struct elf_image *image)
+{
+  bool last;
+
+  lock_acquire (&cache_lock);
+  last = --image->ref_cnt == 0;
+  lock_release (&cache_lock);
+
+  if (last)
+    image_free (image);
+}
+
+/* Frees IMAGE, which has no references left, and gives up its
+   claim on its frames and inode. */
+static void
+image_free (struct elf_image *image)
+{
+  size_t i;
+
+  for (i = 0; i < image->page_cnt; i++)
+    if (image->pages[i].kpage != NULL)
+      pagedir_release_frame (image->pages[i].kpage);
+  inode_close (image->inode);
+  free (image->pages);
+  free (image);
+}
+
+/* Takes IMAGE out of the cache and drops the cache's reference
+   to it, adding IMAGE to DEAD if that was the last.  Must be
+   called with cache_lock held. */
+static void
+uncache (struct elf_image *image, struct list *dead)
+{
+  list_remove (&image->elem);
+  cached_frames -= image->frame_cnt;
+  if (--image->ref_cnt == 0)
+    list_push_back (dead, &image->elem);
+}
+
+/* Frees the images in DEAD. */
+static void
+free_dead (struct list *dead)
+{
+  while (!list_empty (dead))
+    image_free (list_entry (list_pop_front (dead), struct elf_image, elem));
+}
+
+/* Returns the cached image of INODE with a new reference for the
+   caller, or a null pointer if none is cached or the cached one
+   is stale. */
+struct elf_image *
+elfcache_lookup (struct inode *inode)
+{
+  struct elf_image *found = NULL;
+  struct list dead;
+  struct list_elem *e;
+
+  list_init (&dead);
+  lock_acquire (&cache_lock);
+  for (e = list_begin (&images); e != list_end (&images); e = list_next (e))
+    {
+      struct elf_image *image = list_entry (e, struct elf_image, elem);
+
+      if (image->inode == inode)
+        {
+          if (image->write_cnt != inode->write_cnt)
+            uncache (image, &dead);
+          else
+            {
+              list_remove (e);
+              list_push_front (&images, e);
+              image->ref_cnt++;
+              found = image;
+            }
+          break;
+        }
+    }
+  lock_release (&cache_lock);
+
+  free_dead (&dead);
+  return found;
+}
+
+/* Adds IMAGE to the cache, which takes its own reference to it,
+   evicting the least recently used images to stay within
+   ELFCACHE_FRAMES.  IMAGE must be up to date with its file.
+   Images that are too large are not cached. */
+void
+elfcache_insert (struct elf_image *image)
+{
+  struct list dead;
+
+  if (image->frame_cnt > ELFCACHE_FRAMES)
+    return;
+
+  list_init (&dead);
+  lock_acquire (&cache_lock);
+  while (cached_frames + image->frame_cnt > ELFCACHE_FRAMES)
+    uncache (list_entry (list_back (&images), struct elf_image, elem), &dead);
+  image->ref_cnt++;
+  list_push_front (&images, &image->elem);
+  cached_frames += image->frame_cnt;
+  lock_release (&cache_lock);
+
+  free_dead (&dead);
+}
+
+/* Drops the cached image of INODE, if any, because its file is
+   being removed. */
+void
+elfcache_remove (struct inode *inode)
+{
+  struct list dead;
+  struct list_elem *e;
+
+  list_init (&dead);
+  lock_acquire (&cache_lock);
+  for (e = list_begin (&images); e != list_end (&images); e = list_next (e))
+    {
+      struct elf_image *image = list_entry (e, struct elf_image, elem);
+      if (image->inode == inode)
+        {
+          uncache (image, &dead);
+          break;
+        }
+    }
+  lock_release (&cache_lock);
+
+  free_dead (&dead);
+}
+
+/* Drops every image from the cache, giving back the frames that
+   no process maps, so that a failed allocation from the user
+   pool can be retried.  Returns false if the cache was already
+   empty. */
+bool
+elfcache_flush (void)
+{
+  struct list dead;
+  bool flushed;
+
+  list_init (&dead);
+  lock_acquire (&cache_lock);
+  flushed = !list_empty (&images);
+  while (!list_empty (&images))
+    uncache (list_entry (list_front (&images), struct elf_image, elem), &dead);
+  lock_release (&cache_lock);
+
+  free_dead (&dead);
+  return flushed;
+}
@@ -0,0 +1,43 @@
+#ifndef USERPROG_ELFCACHE_H
+#define USERPROG_ELFCACHE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct inode;
+
+/* A page of an executable image. */
+struct image_page
+  {
+    void *upage;                /* User virtual address. */
+    void *kpage;                /* Contents, or null for a zeroed page. */
+    bool writable;              /* Writable by the process. */
+  };
+
+/* An executable, parsed, validated and read into memory, ready to
+   be mapped into new processes.  The frames in PAGES are shared
+   with every process that maps them. */
+struct elf_image
+  {
+    struct list_elem elem;      /* Element in the cache. */
+    struct inode *inode;        /* Executable, held open. */
+    unsigned write_cnt;         /* INODE's write count when read. */
+    int ref_cnt;                /* The cache and loads using it. */
+    void (*entry) (void);       /* Entry point. */
+    size_t page_cnt;            /* Number of elements in PAGES. */
+    size_t frame_cnt;           /* Elements of PAGES with a frame. */
+    struct image_page *pages;   /* Pages, in load order. */
+  };
+
+void elfcache_init (void);
+struct elf_image *elf_image_create (struct inode *);
+bool elf_image_add_page (struct elf_image *, void *upage, void *kpage,
+                         bool writable);
+void elf_image_release (struct elf_image *);
+struct elf_image *elfcache_lookup (struct inode *);
+void elfcache_insert (struct elf_image *);
+void elfcache_remove (struct inode *);
+bool elfcache_flush (void);
+
+#endif /* userprog/elfcache.h */
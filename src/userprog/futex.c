@@ -0,0 +1,191 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "userprog/pagedir.h"
+
+/* Futex wait queues.
+
+   A futex in shared memory is identified by the kernel virtual
+   address of the user word, which names the underlying frame, so
+   that every process mapping the word finds the same queue.  Any
+   other futex is private to its process and is identified by the
+   process and the user address.  Its frame may change when a
+   page shared copy-on-write after fork() is copied, but the key
+   does not.  Waiters are hashed into a fixed table of buckets,
+   each kept in priority order. */
+#define FUTEX_BUCKET_CNT 64
+
+static struct list buckets[FUTEX_BUCKET_CNT];
+
+/* Identifies a futex. */
+struct futex_key
+  {
+    const void *space;          /* Leader of the process, or null. */
+    const void *addr;           /* User address, or kernel if shared. */
+  };
+
+/* A thread sleeping on a futex.  Lives on the waiter's stack. */
+struct futex_waiter
+  {
+    struct list_elem elem;      /* Element in a bucket. */
+    struct futex_key key;       /* Futex slept on. */
+    struct thread *thread;      /* Sleeping thread. */
+    struct semaphore sema;      /* Upped by futex_wakeup(). */
+  };
+
+/* Returns the key of the futex at user address UADDR in the
+   current process. */
+static struct futex_key
+make_key (int *uaddr)
+{
+  struct thread *leader = thread_leader (thread_current ());
+  struct futex_key key;
+
+  if (pagedir_is_shared (leader->pagedir, uaddr))
+    {
+      key.space = NULL;
+      key.addr = pagedir_get_page (leader->pagedir, uaddr);
+    }
+  else
+    {
+      key.space = leader;
+      key.addr = uaddr;
+    }
+  return key;
+}
+
+static bool
+key_equal (const struct futex_key *a, const struct futex_key *b)
+{
+  return a->space == b->space && a->addr == b->addr;
+}
+
+static struct list *
+bucket_for (const struct futex_key *key)
+{
+  return &buckets[hash_bytes (key, sizeof *key) % FUTEX_BUCKET_CNT];
+}
+
+/* Returns true if waiter A has higher priority than waiter B. */
+static bool
+waiter_priority_more (const struct list_elem *a_, const struct list_elem *b_,
+                      void *aux UNUSED)
+{
+  const struct futex_waiter *a = list_entry (a_, struct futex_waiter, elem);
+  const struct futex_waiter *b = list_entry (b_, struct futex_waiter, elem);
+
+  return a->thread->priority > b->thread->priority;
+}
+
+/* Initializes the futex wait queues. */
+void
+futex_init (void)
+{
+  int i;
+
+  for (i = 0; i < FUTEX_BUCKET_CNT; i++)
+    list_init (&buckets[i]);
+}
+
+/* If the word at user address UADDR still holds VAL, sleeps until
+   a futex_wakeup() on the same futex and returns true.
+   Otherwise returns false at once, so that a wakeup sent between
+   the caller's check and this call is never lost.  Also returns
+   false at once if the caller's process is exiting.  UADDR must
+   have been checked to be mapped and writable, so that the page
+   is not shared copy-on-write. */
+bool
+futex_block (int *uaddr, int val)
+{
+  struct futex_waiter w;
+  enum intr_level old_level;
+  int *kaddr = pagedir_get_page (thread_current ()->pagedir, uaddr);
+
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  if (kaddr == NULL || *kaddr != val || thread_leader (thread_current ())->process_exiting)
+    {
+      intr_set_level (old_level);
+      return false;
+    }
+
+  w.key = make_key (uaddr);
+  w.thread = thread_current ();
+  sema_init (&w.sema, 0);
+  list_insert_ordered (bucket_for (&w.key), &w.elem, waiter_priority_more,
+                       NULL);
+  sema_down (&w.sema);
+  intr_set_level (old_level);
+  return true;
+}
+
+/* Wakes up to CNT threads sleeping on the futex at user address
+   UADDR, checked as for futex_block(), highest priority first,
+   and returns the number woken. */
+int
+futex_wakeup (int *uaddr, int cnt)
+{
+  struct futex_key key = make_key (uaddr);
+  struct list *bucket = bucket_for (&key);
+  struct list woken;
+  struct list_elem *e;
+  enum intr_level old_level;
+  int woken_cnt = 0;
+
+  /* Take the waiters out of the bucket before waking any of
+     them, because sema_up() may switch to a woken thread. */
+  list_init (&woken);
+  old_level = intr_disable ();
+  for (e = list_begin (bucket); e != list_end (bucket) && woken_cnt < cnt; )
+    {
+      struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+      e = list_next (e);
+      if (key_equal (&w->key, &key))
+        {
+          list_remove (&w->elem);
+          list_push_back (&woken, &w->elem);
+          woken_cnt++;
+        }
+    }
+  while (!list_empty (&woken))
+    sema_up (&list_entry (list_pop_front (&woken),
+                          struct futex_waiter, elem)->sema);
+  intr_set_level (old_level);
+  return woken_cnt;
+}
+
+/* Wakes every thread of LEADER's process sleeping on any futex,
+   so that it can notice that the process is exiting. */
+void
+futex_wake_process (struct thread *leader)
+{
+  struct list woken;
+  enum intr_level old_level;
+  int i;
+
+  list_init (&woken);
+  old_level = intr_disable ();
+  for (i = 0; i < FUTEX_BUCKET_CNT; i++)
+    {
+      struct list_elem *e = list_begin (&buckets[i]);
+      while (e != list_end (&buckets[i]))
+        {
+          struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+          e = list_next (e);
+          if (thread_leader (w->thread) == leader)
+            {
+              list_remove (&w->elem);
+              list_push_back (&woken, &w->elem);
+            }
+        }
+    }
+  while (!list_empty (&woken))
+    sema_up (&list_entry (list_pop_front (&woken),
+                          struct futex_waiter, elem)->sema);
+  intr_set_level (old_level);
+}
@@ -2,12 +2,42 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <string.h>
+#include <hash.h>
 #include "threads/init.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
+
+/* Page table entry bit, one of those left to the OS, marking a
+   user page shared copy-on-write.  The hardware sees the page as
+   read-only, but the process may write it once it has its own
+   copy.  See pagedir_fork(). */
+#define PTE_COW 0x200
+
+/* Page table entry bit marking a user page of a shared memory
+   segment.  Such pages stay writable and shared across fork(),
+   never copy-on-write. */
+#define PTE_SHARED 0x400
+
+/* Number of page directories that map each frame, keyed by
+   physical frame number.  Frames mapped by a single page
+   directory, the usual case, have no entry. */
+static struct ihash frame_shares;
+static struct lock frame_lock;
 
 static uint32_t *active_pd (void);
 static void invalidate_pagedir (uint32_t *);
+static uint32_t *lookup_page (uint32_t *, const void *, bool create);
+static void frame_release (void *kpage);
+
+/* Initializes the page directory module. */
+void
+pagedir_init (void) 
+{
+  lock_init (&frame_lock);
+  if (!ihash_init (&frame_shares))
+    PANIC ("pagedir_init: out of memory");
+}
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -33,6 +63,7 @@ pagedir_destroy (uint32_t *pd)
     return;
 
   ASSERT (pd != init_page_dir);
+  lock_acquire (&frame_lock);
   for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
     if (*pde & PTE_P) 
       {
@@ -41,12 +72,312 @@ pagedir_destroy (uint32_t *pd)
         
         for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
           if (*pte & PTE_P) 
-            palloc_free_page (pte_get_page (*pte));
+            frame_release (pte_get_page (*pte));
         palloc_free_page (pt);
       }
+  lock_release (&frame_lock);
   palloc_free_page (pd);
 }
 
+/* Returns the physical frame number of KPAGE. */
+static unsigned
+frame_no (void *kpage) 
+{
+  return vtop (kpage) >> PGBITS;
+}
+
+/* Returns the number of page directories that map KPAGE.
+   Must be called with frame_lock held. */
+static unsigned
+frame_share_cnt (void *kpage) 
+{
+  void *cnt = ihash_find (&frame_shares, frame_no (kpage));
+  return cnt != NULL ? (uintptr_t) cnt : 1;
+}
+
+/* Records that one more page directory maps KPAGE.  Returns
+   false if memory is not available.  Must be called with
+   frame_lock held. */
+static bool
+frame_share (void *kpage) 
+{
+  uintptr_t cnt = frame_share_cnt (kpage) + 1;
+  return ihash_insert (&frame_shares, frame_no (kpage), (void *) cnt);
+}
+
+/* Drops a page directory's reference to KPAGE and frees it if
+   that was the last one.  Must be called with frame_lock held. */
+static void
+frame_release (void *kpage) 
+{
+  uintptr_t cnt = frame_share_cnt (kpage);
+
+  if (cnt == 1)
+    palloc_free_page (kpage);
+  else if (cnt == 2)
+    ihash_delete (&frame_shares, frame_no (kpage));
+  else
+    ihash_insert (&frame_shares, frame_no (kpage), (void *) (cnt - 1));
+}
+
+/* Creates a page directory with the same user mappings as PD,
+   sharing all of its frames.  Writable pages become read-only
+   and copy-on-write in both page directories, so that the first
+   one to write such a page gets its own copy of it; see
+   pagedir_copy_on_write().  Pages of shared memory segments stay
+   writable in both.  Returns the new page directory, or a
+   null pointer if memory allocation fails. */
+uint32_t *
+pagedir_fork (uint32_t *pd) 
+{
+  uint32_t *child = pagedir_create ();
+  uint32_t *pde;
+
+  if (child == NULL)
+    return NULL;
+
+  lock_acquire (&frame_lock);
+  for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
+    if (*pde & PTE_P) 
+      {
+        uint32_t *pt = pde_get_pt (*pde);
+        uint32_t *child_pt = palloc_get_page (PAL_ZERO);
+        size_t i;
+
+        if (child_pt == NULL)
+          goto fail;
+        child[pde - pd] = pde_create (child_pt);
+
+        for (i = 0; i < PGSIZE / sizeof *pt; i++)
+          if (pt[i] & PTE_P) 
+            {
+              if (!frame_share (pte_get_page (pt[i])))
+                goto fail;
+              if ((pt[i] & PTE_SHARED) == 0 && (pt[i] & (PTE_W | PTE_COW)))
+                pt[i] = (pt[i] & ~PTE_W) | PTE_COW;
+              child_pt[i] = pt[i];
+            }
+      }
+  lock_release (&frame_lock);
+  invalidate_pagedir (pd);
+  return child;
+
+ fail:
+  lock_release (&frame_lock);
+  invalidate_pagedir (pd);
+  pagedir_destroy (child);
+  return NULL;
+}
+
+/* Adds a mapping in PD from user page UPAGE to KPAGE, a frame
+   that someone else, such as a cached executable image, keeps a
+   reference to as well.  If WRITABLE, the page is mapped
+   copy-on-write, so that the first write gives PD its own copy.
+   Returns false if UPAGE is already mapped or memory is not
+   available. */
+bool
+pagedir_share_page (uint32_t *pd, void *upage, void *kpage, bool writable) 
+{
+  uint32_t *pte;
+  bool success = false;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (pg_ofs (kpage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  pte = lookup_page (pd, upage, true);
+  lock_acquire (&frame_lock);
+  if (pte != NULL && (*pte & PTE_P) == 0 && frame_share (kpage))
+    {
+      *pte = pte_create_user (kpage, false) | (writable ? PTE_COW : 0);
+      success = true;
+    }
+  lock_release (&frame_lock);
+  return success;
+}
+
+/* Adds a writable mapping in PD from user page UPAGE to KPAGE, a
+   frame of a shared memory segment.  Writes through the mapping
+   are seen by every page directory that maps KPAGE.  Returns
+   false if UPAGE is already mapped or memory is not available. */
+bool
+pagedir_map_shared (uint32_t *pd, void *upage, void *kpage) 
+{
+  uint32_t *pte;
+  bool success = false;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (pg_ofs (kpage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  pte = lookup_page (pd, upage, true);
+  lock_acquire (&frame_lock);
+  if (pte != NULL && (*pte & PTE_P) == 0 && frame_share (kpage))
+    {
+      *pte = pte_create_user (kpage, true) | PTE_SHARED;
+      success = true;
+    }
+  lock_release (&frame_lock);
+  return success;
+}
+
+/* Drops a reference to frame KPAGE held outside any page
+   directory, freeing the frame if it was the last one. */
+void
+pagedir_release_frame (void *kpage) 
+{
+  lock_acquire (&frame_lock);
+  frame_release (kpage);
+  lock_release (&frame_lock);
+}
+
+/* Takes a reference, held outside any page directory, to the
+   frame mapped at user page UPAGE in PD, and returns the frame.
+   If the page is writable it becomes copy-on-write, so that the
+   frame keeps its current contents for whoever holds the new
+   reference.  Returns a null pointer if UPAGE is not mapped, is
+   part of a shared memory segment, or memory is not available.
+   Release the reference with pagedir_release_frame(). */
+void *
+pagedir_lend_page (uint32_t *pd, void *upage)
+{
+  uint32_t *pte;
+  void *kpage = NULL;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  lock_acquire (&frame_lock);
+  pte = lookup_page (pd, upage, false);
+  if (pte != NULL && (*pte & (PTE_P | PTE_SHARED)) == PTE_P
+      && frame_share (pte_get_page (*pte)))
+    {
+      kpage = pte_get_page (*pte);
+      if (*pte & (PTE_W | PTE_COW))
+        *pte = (*pte & ~PTE_W) | PTE_COW;
+    }
+  lock_release (&frame_lock);
+
+  if (kpage != NULL)
+    invalidate_pagedir (pd);
+  return kpage;
+}
+
+/* Maps user page UPAGE in PD, which must be writable or
+   copy-on-write, to KPAGE instead, copy-on-write, and drops PD's
+   reference to the frame it mapped before.  KPAGE is a frame
+   that someone else keeps a reference to as well.  Returns false
+   if UPAGE is not mapped that way, is part of a shared memory
+   segment, or memory is not available. */
+bool
+pagedir_replace_page (uint32_t *pd, void *upage, void *kpage)
+{
+  uint32_t *pte;
+  bool success = false;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (pg_ofs (kpage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  lock_acquire (&frame_lock);
+  pte = lookup_page (pd, upage, false);
+  if (pte != NULL && (*pte & (PTE_P | PTE_SHARED)) == PTE_P
+      && (*pte & (PTE_W | PTE_COW)) != 0 && frame_share (kpage))
+    {
+      frame_release (pte_get_page (*pte));
+      *pte = pte_create_user (kpage, false) | PTE_COW;
+      success = true;
+    }
+  lock_release (&frame_lock);
+
+  if (success)
+    invalidate_pagedir (pd);
+  return success;
+}
+
+/* Returns true if the page containing user virtual address
+   UADDR is mapped writable in PD. */
+bool
+pagedir_is_writable (uint32_t *pd, const void *uaddr) 
+{
+  uint32_t *pte;
+
+  ASSERT (is_user_vaddr (uaddr));
+
+  pte = lookup_page (pd, uaddr, false);
+  return pte != NULL && (*pte & (PTE_P | PTE_W)) == (PTE_P | PTE_W);
+}
+
+/* Returns true if the page containing user virtual address
+   UADDR is mapped in PD as shared memory, by
+   pagedir_map_shared(). */
+bool
+pagedir_is_shared (uint32_t *pd, const void *uaddr) 
+{
+  uint32_t *pte;
+
+  ASSERT (is_user_vaddr (uaddr));
+
+  pte = lookup_page (pd, uaddr, false);
+  return pte != NULL && (*pte & (PTE_P | PTE_SHARED)) == (PTE_P | PTE_SHARED);
+}
+
+/* Returns true if the page containing user virtual address
+   UADDR is mapped copy-on-write in PD. */
+bool
+pagedir_is_cow (uint32_t *pd, const void *uaddr) 
+{
+  uint32_t *pte;
+
+  ASSERT (is_user_vaddr (uaddr));
+
+  pte = lookup_page (pd, uaddr, false);
+  return pte != NULL && (*pte & (PTE_P | PTE_COW)) == (PTE_P | PTE_COW);
+}
+
+/* If the page containing user virtual address UADDR is mapped
+   copy-on-write in PD, makes it writable, first giving PD its
+   own copy of the frame if another page directory still shares
+   it.  Returns false if the page is not copy-on-write or memory
+   for the copy is not available. */
+bool
+pagedir_copy_on_write (uint32_t *pd, const void *uaddr) 
+{
+  uint32_t *pte;
+  bool success = false;
+
+  ASSERT (is_user_vaddr (uaddr));
+
+  lock_acquire (&frame_lock);
+  pte = lookup_page (pd, uaddr, false);
+  if (pte != NULL && (*pte & (PTE_P | PTE_COW)) == (PTE_P | PTE_COW))
+    {
+      void *kpage = pte_get_page (*pte);
+
+      if (frame_share_cnt (kpage) == 1)
+        {
+          *pte = (*pte & ~PTE_COW) | PTE_W;
+          success = true;
+        }
+      else
+        {
+          void *copy = palloc_get_page (PAL_USER);
+          if (copy != NULL)
+            {
+              memcpy (copy, kpage, PGSIZE);
+              frame_release (kpage);
+              *pte = vtop (copy) | (*pte & PTE_FLAGS & ~PTE_COW) | PTE_W;
+              success = true;
+            }
+        }
+    }
+  lock_release (&frame_lock);
+
+  if (success)
+    invalidate_pagedir (pd);
+  return success;
+}
+
 /* Returns the address of the page table entry for virtual
    address VADDR in page directory PD.
    If PD does not have a page table for VADDR, behavior depends
@@ -156,6 +487,30 @@ pagedir_clear_page (uint32_t *pd, void *upage)
     }
 }
 
+/* Removes the mapping for user virtual page UPAGE from PD and
+   frees its frame, unless another page directory still maps it.
+   UPAGE need not be mapped. */
+void
+pagedir_free_page (uint32_t *pd, void *upage) 
+{
+  uint32_t *pte;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  pte = lookup_page (pd, upage, false);
+  if (pte != NULL && (*pte & PTE_P) != 0)
+    {
+      void *kpage = pte_get_page (*pte);
+
+      *pte = 0;
+      invalidate_pagedir (pd);
+      lock_acquire (&frame_lock);
+      frame_release (kpage);
+      lock_release (&frame_lock);
+    }
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PD is dirty,
    that is, if the page has been modified since the PTE was
    installed.
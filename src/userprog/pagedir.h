@@ -4,11 +4,23 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+void pagedir_init (void);
 uint32_t *pagedir_create (void);
 void pagedir_destroy (uint32_t *pd);
+uint32_t *pagedir_fork (uint32_t *pd);
+bool pagedir_share_page (uint32_t *pd, void *upage, void *kpage, bool rw);
+bool pagedir_map_shared (uint32_t *pd, void *upage, void *kpage);
+void pagedir_release_frame (void *kpage);
+void *pagedir_lend_page (uint32_t *pd, void *upage);
+bool pagedir_replace_page (uint32_t *pd, void *upage, void *kpage);
+bool pagedir_is_writable (uint32_t *pd, const void *uaddr);
+bool pagedir_is_cow (uint32_t *pd, const void *uaddr);
+bool pagedir_is_shared (uint32_t *pd, const void *uaddr);
+bool pagedir_copy_on_write (uint32_t *pd, const void *uaddr);
 bool pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool rw);
 void *pagedir_get_page (uint32_t *pd, const void *upage);
 void pagedir_clear_page (uint32_t *pd, void *upage);
+void pagedir_free_page (uint32_t *pd, void *upage);
 bool pagedir_is_dirty (uint32_t *pd, const void *upage);
 void pagedir_set_dirty (uint32_t *pd, const void *upage, bool dirty);
 bool pagedir_is_accessed (uint32_t *pd, const void *upage);
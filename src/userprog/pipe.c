@@ -0,0 +1,359 @@
+#include "userprog/pipe.h"
+#include <debug.h>
+#include <poll.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "threads/waitq.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+
+/* Pipes.
+
+   A pipe buffers its data in a ring of up to PIPE_PAGES pages,
+   filled at the tail and drained at the head.  Writes copy bytes
+   into the tail page while it has room.  A write of a whole,
+   page-aligned user page instead lends the writer's frame to the
+   pipe, copy-on-write, and a read of a whole page into a
+   page-aligned user buffer maps the frame into the reader the
+   same way, so that page-sized transfers move frames rather than
+   bytes.
+
+   Readers and writers access user memory through user
+   addresses, with the pipe's lock held, so they must have
+   checked the buffers first.  They pin the pages while they copy,
+   but not while they wait, so a buffer unmapped meanwhile fails
+   the read or write.  They stop waiting when their process starts
+   going down. */
+#define PIPE_PAGES 16           /* Most pages of data in a pipe. */
+
+/* A page of data in a pipe. */
+struct pipe_page
+  {
+    void *kpage;                /* Frame, from the user pool. */
+    uint16_t ofs;               /* Offset of the first byte of data. */
+    uint16_t len;               /* Bytes of data. */
+    bool lent;                  /* Frame still mapped by its writer. */
+  };
+
+struct pipe
+  {
+    struct lock lock;
+    struct wait_queue waiters;  /* Woken whenever the pipe changes. */
+    struct pipe_page pages[PIPE_PAGES]; /* Ring of pages. */
+    size_t head;                /* Index in PAGES of the oldest page. */
+    size_t page_cnt;            /* Pages of data in the ring. */
+    int readers;                /* Open read ends. */
+    int writers;                /* Open write ends. */
+    int pollers;                /* Entries on WAITERS from pipe_poll(). */
+  };
+
+/* Returns a new pipe with one read end and one write end open,
+   or a null pointer if memory is exhausted. */
+struct pipe *
+pipe_create (void)
+{
+  struct pipe *p = malloc (sizeof *p);
+  if (p != NULL)
+    {
+      lock_init (&p->lock);
+      wait_queue_init (&p->waiters);
+      p->head = 0;
+      p->page_cnt = 0;
+      p->readers = 1;
+      p->writers = 1;
+      p->pollers = 0;
+    }
+  return p;
+}
+
+/* Opens one more END of P. */
+void
+pipe_reopen (struct pipe *p, enum pipe_end end)
+{
+  lock_acquire (&p->lock);
+  if (end == PIPE_READ)
+    p->readers++;
+  else
+    p->writers++;
+  lock_release (&p->lock);
+}
+
+/* Returns the page at the tail of P's ring. */
+static struct pipe_page *
+tail_page (struct pipe *p)
+{
+  ASSERT (p->page_cnt > 0);
+  return &p->pages[(p->head + p->page_cnt - 1) % PIPE_PAGES];
+}
+
+/* Appends a page to P's ring, which must not be full, and
+   returns it. */
+static struct pipe_page *
+push_page (struct pipe *p, void *kpage, size_t len, bool lent)
+{
+  struct pipe_page *pp;
+
+  ASSERT (p->page_cnt < PIPE_PAGES);
+  p->page_cnt++;
+  pp = tail_page (p);
+  pp->kpage = kpage;
+  pp->ofs = 0;
+  pp->len = len;
+  pp->lent = lent;
+  return pp;
+}
+
+/* Removes the page at the head of P's ring and gives up the
+   pipe's reference to its frame. */
+static void
+pop_page (struct pipe *p)
+{
+  ASSERT (p->page_cnt > 0);
+  pagedir_release_frame (p->pages[p->head].kpage);
+  p->head = (p->head + 1) % PIPE_PAGES;
+  p->page_cnt--;
+}
+
+/* Wakes every thread waiting for P to change. */
+static void
+wake (struct pipe *p)
+{
+  wait_queue_wake (&p->waiters);
+}
+
+/* Releases P's lock, which must be held, until P changes or the
+   current process starts going down.  Returns false in the
+   latter case. */
+static bool
+wait_for_change (struct pipe *p)
+{
+  struct wait_entry e, exit_e;
+  struct waiter w;
+
+  waiter_init (&w);
+  wait_queue_add (&p->waiters, &e, &w);
+  if (!process_poll_exit (&exit_e, &w))
+    {
+      lock_release (&p->lock);
+      waiter_sleep (&w, -1);
+      lock_acquire (&p->lock);
+    }
+  wait_queue_remove (&exit_e);
+  wait_queue_remove (&e);
+  return !process_poll_exit (NULL, NULL);
+}
+
+/* Frees P, which nothing refers to any more. */
+static void
+destroy (struct pipe *p)
+{
+  while (p->page_cnt > 0)
+    pop_page (p);
+  free (p);
+}
+
+/* Closes one END of P, freeing P once both ends are closed
+   everywhere and no poll() waits on it. */
+void
+pipe_close (struct pipe *p, enum pipe_end end)
+{
+  bool dead;
+
+  lock_acquire (&p->lock);
+  if (end == PIPE_READ)
+    {
+      if (--p->readers == 0)
+        wake (p);
+    }
+  else
+    {
+      if (--p->writers == 0)
+        wake (p);
+    }
+  dead = p->readers == 0 && p->writers == 0 && p->pollers == 0;
+  lock_release (&p->lock);
+
+  if (dead)
+    destroy (p);
+}
+
+/* Returns the poll() events that are ready on END of P.  If W is
+   non-null, also makes W wait, through E, for P to change, until
+   E is removed with pipe_unpoll().  P stays allocated until then,
+   even if its descriptors are closed meanwhile. */
+unsigned
+pipe_poll (struct pipe *p, enum pipe_end end, struct wait_entry *e,
+           struct waiter *w)
+{
+  unsigned events = 0;
+
+  lock_acquire (&p->lock);
+  if (w != NULL)
+    {
+      wait_queue_add (&p->waiters, e, w);
+      p->pollers++;
+    }
+  if (end == PIPE_READ)
+    {
+      if (p->page_cnt > 0 || p->writers == 0)
+        events |= POLLIN;
+      if (p->writers == 0)
+        events |= POLLHUP;
+    }
+  else
+    {
+      struct pipe_page *pp = p->page_cnt > 0 ? tail_page (p) : NULL;
+
+      if (p->readers == 0)
+        events |= POLLERR;
+      else if (p->page_cnt < PIPE_PAGES
+               || (!pp->lent && pp->ofs + pp->len < PGSIZE))
+        events |= POLLOUT;
+    }
+  lock_release (&p->lock);
+  return events;
+}
+
+/* Removes E, added to P by pipe_poll(), freeing P if its
+   descriptors were all closed meanwhile. */
+void
+pipe_unpoll (struct pipe *p, struct wait_entry *e)
+{
+  bool dead;
+
+  lock_acquire (&p->lock);
+  wait_queue_remove (e);
+  dead = --p->pollers == 0 && p->readers == 0 && p->writers == 0;
+  lock_release (&p->lock);
+
+  if (dead)
+    destroy (p);
+}
+
+/* Reads up to SIZE bytes from P into user buffer UBUF, which
+   must be writable, waiting until there is data or no writer is
+   left.  Returns the number of bytes read, 0 at end of file or if
+   the current process starts going down, or -1 if UBUF was
+   unmapped while waiting. */
+int
+pipe_read (struct pipe *p, void *ubuf, size_t size)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  uint8_t *dst = ubuf;
+  size_t done = 0;
+  bool pinned;
+
+  lock_acquire (&p->lock);
+  while (size > 0 && p->page_cnt == 0 && p->writers > 0)
+    if (!wait_for_change (p))
+      break;
+
+  pinned = size > 0 && p->page_cnt > 0;
+  if (pinned && !process_pin_user (ubuf, size, true))
+    {
+      lock_release (&p->lock);
+      return -1;
+    }
+  while (done < size && p->page_cnt > 0)
+    {
+      struct pipe_page *pp = &p->pages[p->head];
+      size_t chunk;
+
+      /* Hand over a whole page by mapping its frame. */
+      if (pp->ofs == 0 && pp->len == PGSIZE && pg_ofs (dst + done) == 0
+          && size - done >= PGSIZE
+          && pagedir_replace_page (pd, dst + done, pp->kpage))
+        {
+          pop_page (p);
+          done += PGSIZE;
+          continue;
+        }
+
+      chunk = size - done < pp->len ? size - done : pp->len;
+      memcpy (dst + done, (uint8_t *) pp->kpage + pp->ofs, chunk);
+      pp->ofs += chunk;
+      pp->len -= chunk;
+      done += chunk;
+      if (pp->len == 0)
+        pop_page (p);
+    }
+
+  if (pinned)
+    process_unpin_user ();
+  if (done > 0)
+    wake (p);
+  lock_release (&p->lock);
+  return done;
+}
+
+/* Writes SIZE bytes from user buffer UBUF to P, waiting for room
+   as needed.  Returns the number of bytes written, which is less
+   than SIZE only if every read end is closed, memory is
+   exhausted, the current process starts going down or UBUF is
+   unmapped while waiting, or -1 if none could be written for one
+   of these reasons. */
+int
+pipe_write (struct pipe *p, const void *ubuf, size_t size)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  const uint8_t *src = ubuf;
+  size_t done = 0;
+
+  lock_acquire (&p->lock);
+  while (done < size && p->readers > 0)
+    {
+      struct pipe_page *pp = p->page_cnt > 0 ? tail_page (p) : NULL;
+      size_t room = pp != NULL && !pp->lent ? PGSIZE - pp->ofs - pp->len : 0;
+      size_t len = size - done < PGSIZE ? size - done : PGSIZE;
+      void *kpage = NULL;
+      size_t chunk;
+
+      if (room == 0 && p->page_cnt == PIPE_PAGES)
+        {
+          if (!wait_for_change (p))
+            break;
+          continue;
+        }
+
+      /* Pin the most this round can take from UBUF. */
+      if (!process_pin_user (src + done, len, false))
+        break;
+
+      /* Hand over a whole page by lending its frame. */
+      if (room == 0 && pg_ofs (src + done) == 0 && len == PGSIZE)
+        kpage = pagedir_lend_page (pd, (void *) (src + done));
+      if (kpage != NULL)
+        {
+          push_page (p, kpage, PGSIZE, true);
+          chunk = PGSIZE;
+        }
+      else
+        {
+          if (room == 0)
+            {
+              kpage = palloc_get_page (PAL_USER);
+              if (kpage == NULL)
+                {
+                  process_unpin_user ();
+                  break;
+                }
+              pp = push_page (p, kpage, 0, false);
+              room = PGSIZE;
+            }
+          chunk = len < room ? len : room;
+          memcpy ((uint8_t *) pp->kpage + pp->ofs + pp->len, src + done, chunk);
+          pp->len += chunk;
+        }
+      process_unpin_user ();
+      done += chunk;
+      wake (p);
+    }
+  lock_release (&p->lock);
+
+  return done > 0 || size == 0 ? (int) done : -1;
+}
@@ -0,0 +1,28 @@
+#ifndef USERPROG_PIPE_H
+#define USERPROG_PIPE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Ends of a pipe, in the order pipe() returns their
+   descriptors. */
+enum pipe_end
+  {
+    PIPE_READ,                  /* Read end. */
+    PIPE_WRITE                  /* Write end. */
+  };
+
+struct pipe;
+struct wait_entry;
+struct waiter;
+
+struct pipe *pipe_create (void);
+void pipe_reopen (struct pipe *, enum pipe_end);
+void pipe_close (struct pipe *, enum pipe_end);
+int pipe_read (struct pipe *, void *ubuf, size_t size);
+int pipe_write (struct pipe *, const void *ubuf, size_t size);
+unsigned pipe_poll (struct pipe *, enum pipe_end, struct wait_entry *,
+                    struct waiter *);
+void pipe_unpoll (struct pipe *, struct wait_entry *);
+
+#endif /* userprog/pipe.h */
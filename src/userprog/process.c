@@ -18,148 +18,306 @@
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "threads/waitq.h"
+#include "userprog/elfcache.h"
+#include "userprog/futex.h"
+#include "userprog/shm.h"
 #include "syscall.h"
 
 static thread_func start_process NO_RETURN;
-static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static thread_func start_uthread NO_RETURN;
+static thread_func start_fork NO_RETURN;
+static void stop_process (struct thread *leader);
+static void kill_uthreads (struct thread *leader);
+static void release_uthread (struct thread *t);
+static uint8_t *uthread_stack_page (int slot);
+static bool load (const char *file_name, struct file *file,
+                  void (**eip) (void), void **esp);
+
+/* Handed from process_spawn() to start_process(). */
+struct exec_start
+  {
+    struct file *file;          /* Executable, opened by the parent. */
+    const struct arg_block *args; /* Arguments and environment. */
+    struct thread *parent;      /* Process to take descriptors from. */
+    const struct spawn_fd *fds; /* Descriptors to take. */
+    int fd_cnt;                 /* Number of elements in FDS. */
+  };
+
+/* Returns a new, empty argument block, or a null pointer if
+   memory is exhausted. */
+struct arg_block *
+arg_block_create (void)
+{
+  struct arg_block *args = palloc_get_page (0);
+  if (args != NULL)
+    {
+      args->argc = 0;
+      args->cnt = 0;
+      args->size = 0;
+    }
+  return args;
+}
+
+/* Appends the LEN bytes at S, followed by a null terminator, to
+   ARGS.  Returns false if ARGS is full. */
+bool
+arg_block_add (struct arg_block *args, const char *s, size_t len)
+{
+  size_t space = PGSIZE - offsetof (struct arg_block, strings) - args->size;
+
+  if (args->cnt >= SPAWN_ARG_MAX || len >= space)
+    return false;
+  memcpy (args->strings + args->size, s, len);
+  args->strings[args->size + len] = '\0';
+  args->ofs[args->cnt++] = args->size;
+  args->size += len + 1;
+  return true;
+}
+
+/* Frees ARGS. */
+void
+arg_block_destroy (struct arg_block *args)
+{
+  palloc_free_page (args);
+}
 
 /* Starts a new thread running a user program loaded from
-   FILENAME.  The new thread may be scheduled (and may even exit)
-   before process_execute() returns.  Returns the new process's
-   thread id, or TID_ERROR if the thread cannot be created. */
+   FILENAME.  Waits until the program has been loaded.  Returns
+   the new process's thread id, or TID_ERROR if the thread cannot
+   be created or the program cannot be loaded. */
 tid_t
 process_execute (const char *file_name) 
 {
-  char *fn_copy;
-  tid_t tid;
-
-  /* Make a copy of FILE_NAME.
-     Otherwise there's a race between the caller and load(). */
-
-  //this fn_copy is not only filename but also parameters
-  fn_copy = palloc_get_page (0);
-  if (fn_copy == NULL)
+  struct arg_block *args;
+  const char *p;
+  size_t len;
+  tid_t tid = TID_ERROR;
+
+  /* Split FILE_NAME, which is not only the file name but also
+     the parameters, into a copy.  Otherwise there's a race
+     between the caller and load(). */
+  args = arg_block_create ();
+  if (args == NULL)
     return TID_ERROR;
-  strlcpy (fn_copy, file_name, PGSIZE);
-  
-  /* Create a new thread to execute FILE_NAME. */
-  char *dummy;
-  file_name = strtok_r((char *)file_name, " ", &dummy);
-  if(openTest(file_name) == false)  // ch
-	  tid = TID_ERROR;
-  else
-	  tid = thread_create (file_name, PRI_DEFAULT, start_process, fn_copy);
+  for (p = file_name; ; p += len)
+    {
+      p += strspn (p, " ");
+      len = strcspn (p, " ");
+      if (len == 0)
+        break;
+      if (!arg_block_add (args, p, len))
+        goto done;
+    }
+  args->argc = args->cnt;
 
-  if (tid == TID_ERROR)
-    palloc_free_page (fn_copy); 
+  if (args->argc > 0)
+    process_spawn (args->strings, args, NULL, 0, &tid, 1);
+
+ done:
+  arg_block_destroy (args);
   return tid;
 }
 
-/* Parsing the arguments and put them into the stack */
-static void
-enstack (char *file_name, char *arguments, void **esp)
-{
-  static const int WORD_SIZE = 4;
-  char* token;
-  char* save_ptr;
-  int argument_length;
-
-  int argc = 0;
-  char** argv = malloc(sizeof(char*));
-
-  /* Put the arguments into the stack - using strtok_r library function */
-  argument_length = strlen(file_name) + 1;
-  *esp -= argument_length;
-  memcpy(*esp, file_name, argument_length);
-  argv = realloc(argv, (argc+1)*sizeof(char*));
-  argv[argc] = *esp;
-  argc++;
-  for(token = strtok_r(arguments, " ", &save_ptr); token != NULL; token = strtok_r(NULL, " ", &save_ptr))
-  {
-    argument_length = strlen(token) + 1;
-    *esp -= argument_length;
-    
-    memcpy(*esp, token, argument_length);
-
-    argv = realloc(argv, (argc+1)*sizeof(char*));
-    argv[argc] = *esp;
-    argc++;
-  }
+/* Starts N processes running the program FILE_NAME with the
+   arguments and environment in ARGS, each one also getting its
+   own open file for the FD_CNT descriptors in FDS.  FILE_NAME is
+   looked up only once.  Waits until every child has loaded, so
+   the caller may free ARGS and FDS on return, and stores in
+   TIDS[] each child's thread id, or TID_ERROR if it could not be
+   created or loaded.  Returns the number of children started.
+
+   TIDS may be a user address, written through only once every
+   child has loaded, so that other threads of the process cannot
+   change the tids the children are looked up by.  If it has been
+   unmapped by then, the tids are lost. */
+int
+process_spawn (const char *file_name, const struct arg_block *args,
+               const struct spawn_fd *fds, int fd_cnt, tid_t tids[], int n)
+{
+  struct thread *cur = thread_current ();
+  struct exec_start *starts;
+  struct file *file;
+  tid_t *ktids;
+  int created, started;
+  int i;
 
-  /* Alignment */
-  while(*(int*)(*esp) % WORD_SIZE > 0) (*esp)--;
-  *esp -= WORD_SIZE;
-  *(int*)(*esp) = 0;
+  for (i = 0; i < n; i++)
+    tids[i] = TID_ERROR;
+  if (n <= 0)
+    return 0;
 
+  starts = malloc (n * sizeof *starts);
+  ktids = malloc (n * sizeof *ktids);
+  if (starts == NULL || ktids == NULL)
+    {
+      free (starts);
+      free (ktids);
+      return 0;
+    }
 
-  /* Put the addresses of the arguments into the stack */
-  int argc_iter;
-  for(argc_iter = argc-1; argc_iter >= 0; argc_iter--)
-  {
-    *esp -= WORD_SIZE;
-    memcpy(*esp, &argv[argc_iter], sizeof(char*));
-  }
+  /* Resolve the executable here, once.  Each child gets its own
+     open file, which denies writes until the child exits. */
+  lock_acquire (&fl);
+  file = filesys_open (file_name);
+  lock_release (&fl);
+  if (file == NULL)
+    {
+      free (starts);
+      free (ktids);
+      return 0;
+    }
+
+  for (created = 0; created < n; created++)
+    {
+      struct exec_start *start = &starts[created];
+
+      lock_acquire (&fl);
+      start->file = file_reopen (file);
+      if (start->file != NULL)
+        file_deny_write (start->file);
+      lock_release (&fl);
+      if (start->file == NULL)
+        break;
+      start->args = args;
+      start->parent = thread_leader (cur);
+      start->fds = fds;
+      start->fd_cnt = fd_cnt;
+
+      /* The child runs in the same scheduling class as its creator */
+      ktids[created] = thread_create_sched (file_name, PRI_DEFAULT,
+                                            cur->sched_class, cur->time_slice,
+                                            start_process, start);
+      if (ktids[created] == TID_ERROR)
+        {
+          lock_acquire (&fl);
+          file_close (start->file);
+          lock_release (&fl);
+          break;
+        }
+    }
 
+  /* The children load in parallel.  Wait for all of them, since
+     they read STARTS, ARGS and FDS until they are done. */
+  started = 0;
+  for (i = 0; i < created; i++)
+    {
+      struct child *c = get_child (ktids[i]);
+      sema_down (&c->loaded);
+      if (c->load_status == 1)
+        {
+          cur->child_cnt++;
+          started++;
+        }
+      else
+        ktids[i] = TID_ERROR;
+    }
+  if (is_user_vaddr (tids))
+    process_copy_out (tids, ktids, created * sizeof *tids);
+  else
+    memcpy (tids, ktids, created * sizeof *tids);
 
-  /* (char**) argv indicates the first address of argument_address */
-  *esp -= WORD_SIZE;
-  *(int*)(*esp) = (int)(*esp) + WORD_SIZE;
+  lock_acquire (&fl);
+  file_close (file);
+  lock_release (&fl);
+  free (starts);
+  free (ktids);
+  return started;
+}
 
-  /* Put argc (the number of arguments) into the stack */
-  *esp -= WORD_SIZE;
-  *(int*)(*esp) = argc;
+/* Copies ARGS onto the new user stack at *ESP with a single
+   memcpy(), then lays out argv[] and envp[] and the arguments to
+   _start() below the strings.  Returns false if they do not all
+   fit in the stack page below *ESP. */
+static bool
+push_args (const struct arg_block *args, void **esp)
+{
+  int envc = args->cnt - args->argc;
+  size_t str_size = ROUND_UP (args->size, sizeof (char *));
+  size_t room = PGSIZE - ((uint8_t *) PHYS_BASE - (uint8_t *) *esp);
+  char *strings;
+  char **argv, **envp;
+  uint32_t *sp;
+  int i;
 
-  *esp -= WORD_SIZE;
-  *(int*)(*esp) = 0;
+  /* The strings, argv[] and envp[] with their null terminators,
+     then envp, argv, argc and a fake return address. */
+  if (str_size + (args->cnt + 2 + 4) * sizeof (char *) > room)
+    return false;
 
-  free(argv);
+  strings = (char *) *esp - str_size;
+  memcpy (strings, args->strings, args->size);
+
+  envp = (char **) strings - (envc + 1);
+  argv = envp - (args->argc + 1);
+  for (i = 0; i < args->argc; i++)
+    argv[i] = strings + args->ofs[i];
+  argv[i] = NULL;
+  for (i = 0; i < envc; i++)
+    envp[i] = strings + args->ofs[args->argc + i];
+  envp[i] = NULL;
+
+  sp = (uint32_t *) argv;
+  *--sp = (uint32_t) envp;
+  *--sp = (uint32_t) argv;
+  *--sp = args->argc;
+  *--sp = 0;
+  *esp = sp;
+  return true;
 }
 
 /* A thread function that loads a user process and starts it
    running. */
 static void
-start_process (void *file_name_)
+start_process (void *start_)
 {
-  char *file_name = file_name_;
+  struct exec_start *start = start_;
+  struct child *c = thread_current()->myself;
   struct intr_frame if_;
   bool success;
+  int i;
 
-  char *args;
-  file_name = strtok_r((char*)file_name, " ", &args);
+  /* The file stays open, write-denied, until the process exits,
+     whether or not the load succeeds */
+  thread_current()->executing_file = start->file;
+  thread_current()->is_process = true;
 
   /* Initialize interrupt frame and load executable. */
   memset (&if_, 0, sizeof if_);
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (file_name, &if_.eip, &if_.esp);
+  success = load (thread_current()->name, start->file, &if_.eip, &if_.esp);
 
   /* When executing user program, if there is no cwd, set ROOT */
   if(thread_current()->directory == NULL)
 	  thread_current()->directory = dir_open_root();
 
+  /* Put the arguments into the stack and take the descriptors
+     after the file is loaded successfully */
   if(success)
-  {
-	  thread_current()->myself->load_status = 1;
+	  success = push_args(start->args, &if_.esp);
+  for(i = 0; success && i < start->fd_cnt; i++)
+	  success = inherit_fd(start->parent, start->fds[i].parent_fd,
+	                       start->fds[i].child_fd);
 
-  	/* Parse the arguments and put them into the stack after the file is loaded successfully */
-	  enstack(file_name, args, &if_.esp);
-  
-  	/* Deny executing file write */
-	  lock_acquire(&fl);
-	  thread_current()->executing_file = filesys_open(file_name);
-	  file_deny_write(thread_current()->executing_file);
-	  lock_release(&fl);
+  if(success)
+  {
+	  c->is_process = true;
+	  c->load_status = 1;
+  }
+  else
+  {
+	  c->load_status = -1;
+	  c->exit_status = -1;
   }
 
+  /* Let the parent return, START is gone after this */
+  sema_up(&c->loaded);
+
   /* If load failed, quit. */
-  palloc_free_page (file_name);
   if ( ! success)
-  {
-	thread_current()->myself->load_status = -1;
-	thread_current()->myself->exit_status = -1;
     thread_exit ();
-  }
   /* Start the user process by simulating a return from an
      interrupt, implemented by intr_exit (in
      threads/intr-stubs.S).  Because intr_exit takes all of its
@@ -170,6 +328,390 @@ start_process (void *file_name_)
   NOT_REACHED ();
 }
 
+/* Handed from process_fork() to start_fork(). */
+struct fork_start
+  {
+    struct intr_frame if_;      /* User registers at the fork() call. */
+    uint32_t *pagedir;          /* Copy-on-write copy of the address space. */
+    struct thread *parent;      /* Process to copy descriptors from. */
+    int slot;                   /* Stack slot of the forking user
+                                   thread, or -1 for the main thread. */
+  };
+
+/* Starts a new process that is a copy of the current one: it
+   shares the memory copy-on-write, gets its own open files for
+   the same descriptors, and resumes in user mode with the
+   registers in IF_, except that fork() returns 0 there.  The
+   executable is not read again.  Waits until the child is set
+   up.  Returns the child's thread id, or TID_ERROR if it cannot
+   be created. */
+tid_t
+process_fork (const struct intr_frame *if_)
+{
+  struct thread *cur = thread_current ();
+  struct fork_start *start;
+  struct child *c;
+  tid_t tid;
+
+  start = malloc (sizeof *start);
+  if (start == NULL)
+    return TID_ERROR;
+  start->if_ = *if_;
+  start->parent = thread_leader (cur);
+  start->slot = cur->leader != NULL ? cur->uthread_slot : -1;
+  start->pagedir = pagedir_fork (cur->pagedir);
+  if (start->pagedir == NULL)
+    {
+      free (start);
+      return TID_ERROR;
+    }
+
+  /* The child runs in the same scheduling class as its creator */
+  tid = thread_create_sched (cur->name, PRI_DEFAULT, cur->sched_class,
+                             cur->time_slice, start_fork, start);
+  if (tid == TID_ERROR)
+    {
+      pagedir_destroy (start->pagedir);
+      free (start);
+      return TID_ERROR;
+    }
+
+  c = get_child (tid);
+  sema_down (&c->loaded);
+  if (c->load_status == 1)
+    cur->child_cnt++;
+  else
+    tid = TID_ERROR;
+  free (start);
+  return tid;
+}
+
+/* A thread function that takes over the address space made by
+   process_fork() and returns to user mode as the child. */
+static void
+start_fork (void *start_)
+{
+  struct fork_start *start = start_;
+  struct thread *t = thread_current ();
+  struct child *c = t->myself;
+  struct intr_frame if_ = start->if_;
+  bool success;
+  int slot;
+
+  t->pagedir = start->pagedir;
+  t->is_process = true;
+  process_activate ();
+
+  /* The copy includes the stacks of the parent's user threads,
+     which do not come along.  Free their slots, except the one
+     of the thread that forked, if any, since the child runs on
+     its stack. */
+  for (slot = 0; slot < UTHREAD_MAX; slot++)
+    if (slot == start->slot)
+      t->uthread_slots |= 1u << slot;
+    else
+      pagedir_free_page (t->pagedir, uthread_stack_page (slot));
+
+  /* thread_create() already reopened the working directory */
+  success = inherit_files (start->parent) && shm_inherit (start->parent);
+  if (success)
+    {
+      c->is_process = true;
+      c->load_status = 1;
+    }
+  else
+    {
+      c->load_status = -1;
+      c->exit_status = -1;
+    }
+
+  /* Let the parent return, START is gone after this */
+  sema_up (&c->loaded);
+  if (!success)
+    thread_exit ();
+
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Arguments handed from process_create_thread() to
+   start_uthread(). */
+struct uthread_start
+  {
+    void (*eip) (void);         /* User entry point. */
+    void *esp;                  /* Initial user stack pointer. */
+    struct thread *leader;      /* Main thread of the process. */
+    int slot;                   /* User stack slot. */
+  };
+
+/* Returns the user stack page of user thread slot SLOT.  Slots
+   sit below the main thread's stack, each one above an unmapped
+   guard page. */
+static uint8_t *
+uthread_stack_page (int slot)
+{
+  return (uint8_t *) PHYS_BASE - (2 * slot + 3) * PGSIZE;
+}
+
+/* Starts a user thread in the current process that begins at
+   user address START as if called with FUNC and ARG, and has its
+   own one-page stack.  The new thread shares the page directory,
+   open files and working directory of the process, and can be
+   waited for with process_wait() by the thread that created it.
+   Returns the new thread's tid, or TID_ERROR if there is no free
+   stack slot or memory. */
+tid_t
+process_create_thread (void (*start) (void), void *func, void *arg)
+{
+  struct thread *cur = thread_current ();
+  struct thread *leader = thread_leader (cur);
+  struct uthread_start *us;
+  enum intr_level old_level;
+  uint32_t *kstack;
+  uint8_t *kpage;
+  tid_t tid;
+  int slot;
+
+  if (leader->pagedir == NULL || leader->process_exiting)
+    return TID_ERROR;
+
+  /* Claim a stack slot. */
+  old_level = intr_disable ();
+  for (slot = 0; slot < UTHREAD_MAX; slot++)
+    if ((leader->uthread_slots & (1u << slot)) == 0)
+      break;
+  if (slot < UTHREAD_MAX)
+    {
+      leader->uthread_slots |= 1u << slot;
+      leader->uthread_cnt++;
+    }
+  intr_set_level (old_level);
+  if (slot == UTHREAD_MAX)
+    return TID_ERROR;
+
+  us = malloc (sizeof *us);
+  kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+  if (us == NULL || kpage == NULL
+      || !pagedir_set_page (leader->pagedir, uthread_stack_page (slot),
+                            kpage, true))
+    goto fail;
+
+  /* Lay out START's frame: a null return address, then FUNC
+     and ARG as its arguments. */
+  kstack = (uint32_t *) (kpage + PGSIZE);
+  *--kstack = (uint32_t) arg;
+  *--kstack = (uint32_t) func;
+  *--kstack = 0;
+
+  us->eip = start;
+  us->esp = uthread_stack_page (slot) + PGSIZE - 3 * sizeof (uint32_t);
+  us->leader = leader;
+  us->slot = slot;
+  tid = thread_create_sched (cur->name, PRI_DEFAULT, cur->sched_class,
+                             cur->time_slice, start_uthread, us);
+  if (tid != TID_ERROR)
+    return tid;
+
+  /* The stack page is installed, so free it along with its
+     mapping. */
+  pagedir_free_page (leader->pagedir, uthread_stack_page (slot));
+  kpage = NULL;
+ fail:
+  palloc_free_page (kpage);
+  free (us);
+  old_level = intr_disable ();
+  leader->uthread_slots &= ~(1u << slot);
+  if (--leader->uthread_cnt == 0 && leader->process_exiting)
+    sema_up (&leader->uthreads_done);
+  intr_set_level (old_level);
+  return TID_ERROR;
+}
+
+/* A thread function that joins the address space of a process
+   and jumps to user mode, as start_process() does for the main
+   thread. */
+static void
+start_uthread (void *us_)
+{
+  struct uthread_start *us = us_;
+  struct thread *t = thread_current ();
+  struct intr_frame if_;
+
+  t->leader = us->leader;
+  t->uthread_slot = us->slot;
+  t->pagedir = us->leader->pagedir;
+  t->myself->load_status = 1;
+  process_activate ();
+
+  memset (&if_, 0, sizeof if_);
+  if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
+  if_.cs = SEL_UCSEG;
+  if_.eflags = FLAG_IF | FLAG_MBS;
+  if_.eip = us->eip;
+  if_.esp = us->esp;
+  free (us);
+
+  process_check_killed ();
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Terminates the whole process of the current thread with exit
+   STATUS.  Called when a user thread exits or faults; the main
+   thread reports STATUS as it goes down at its next kernel
+   entry, and the other user threads follow it. */
+void
+process_kill (int status)
+{
+  struct thread *leader = thread_leader (thread_current ());
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (!leader->process_exiting)
+    {
+      if (leader->myself != NULL)
+        leader->myself->exit_status = status;
+      stop_process (leader);
+    }
+  intr_set_level (old_level);
+  thread_exit ();
+}
+
+/* Exits the current thread if its process is going down.  Called
+   on the way back to user mode, possibly with interrupts off. */
+void
+process_check_killed (void)
+{
+  struct thread *t = thread_current ();
+  struct thread *leader = thread_leader (t);
+
+  if (!leader->process_exiting)
+    return;
+
+  /* Going down closes files and frees memory, which may sleep. */
+  ASSERT (!intr_context ());
+  intr_enable ();
+  if (t == leader)
+    exit (t->myself != NULL ? t->myself->exit_status : -1);
+  thread_exit ();
+}
+
+/* Returns true if the current process is going down.  If W is
+   non-null, also makes W wait, through E, for that to happen,
+   until E is removed with wait_queue_remove().  Blocking waits on
+   behalf of user threads use this to give up early, so that the
+   threads can exit. */
+bool
+process_poll_exit (struct wait_entry *e, struct waiter *w)
+{
+  struct thread *leader = thread_leader (thread_current ());
+
+  if (w != NULL)
+    wait_queue_add (&leader->exit_queue, e, w);
+  return leader->process_exiting;
+}
+
+/* Keeps the pages of the current process from being unmapped by
+   shm_detach() in another of its threads until
+   process_unpin_user(), so that the kernel can copy through the
+   SIZE bytes at UADDR without faulting.  Returns false, without
+   pinning, if some of those pages are gone already, or if WRITE
+   and the process may not write them.  Pages shared copy-on-write
+   count as writable, since writes fault and copy them.
+
+   Must not be nested, nor held across a wait. */
+bool
+process_pin_user (const void *uaddr, size_t size, bool write)
+{
+  struct thread *cur = thread_current ();
+  struct thread *leader = thread_leader (cur);
+  const uint8_t *p = uaddr;
+  const uint8_t *end = p + size;
+
+  rwlock_read_acquire (&leader->user_mem);
+  for (; p < end; p = (const uint8_t *) pg_round_down (p) + PGSIZE)
+    if (pagedir_get_page (cur->pagedir, p) == NULL
+        || (write && !pagedir_is_writable (cur->pagedir, p)
+            && !pagedir_is_cow (cur->pagedir, p)))
+      {
+        rwlock_read_release (&leader->user_mem);
+        return false;
+      }
+  return true;
+}
+
+/* Lets the pages pinned by process_pin_user() go. */
+void
+process_unpin_user (void)
+{
+  rwlock_read_release (&thread_leader (thread_current ())->user_mem);
+}
+
+/* Copies SIZE bytes from SRC to user address UDST with the pages
+   pinned.  Returns false, having copied nothing, if UDST is no
+   longer mapped writable. */
+bool
+process_copy_out (void *udst, const void *src, size_t size)
+{
+  if (!process_pin_user (udst, size, true))
+    return false;
+  memcpy (udst, src, size);
+  process_unpin_user ();
+  return true;
+}
+
+/* Marks LEADER's process as going down and wakes its threads
+   from every wait they can give up early.  Interrupts must be
+   off. */
+static void
+stop_process (struct thread *leader)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  leader->process_exiting = true;
+  futex_wake_process (leader);
+  wait_queue_wake (&leader->exit_queue);
+}
+
+/* Makes every other thread of LEADER's process exit and waits
+   until they have.  Threads blocked in the kernel are woken; the
+   rest exit at their next return to user mode. */
+static void
+kill_uthreads (struct thread *leader)
+{
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (!leader->process_exiting)
+    stop_process (leader);
+  if (leader->uthread_cnt > 0)
+    sema_down (&leader->uthreads_done);
+  intr_set_level (old_level);
+}
+
+/* Gives back user thread T's stack and leaves the shared address
+   space, waking the leader if it is waiting for T. */
+static void
+release_uthread (struct thread *t)
+{
+  struct thread *leader = t->leader;
+  uint8_t *upage = uthread_stack_page (t->uthread_slot);
+  enum intr_level old_level;
+
+  pagedir_free_page (t->pagedir, upage);
+
+  /* Switch away from the shared page directory before the
+     leader can destroy it. */
+  old_level = intr_disable ();
+  t->pagedir = NULL;
+  pagedir_activate (NULL);
+  leader->uthread_slots &= ~(1u << t->uthread_slot);
+  if (--leader->uthread_cnt == 0 && leader->process_exiting)
+    sema_up (&leader->uthreads_done);
+  intr_set_level (old_level);
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
@@ -182,34 +724,108 @@ start_process (void *file_name_)
 int
 process_wait (tid_t child_tid) 
 {
-  struct child *c = get_child(child_tid);
-  if(c == NULL)		// TID is invalid or not a child
-	  return -1;
+  int status;
 
-  if(c->parent_is_waiting == true)	// process_wait() has already called
-	  return -1;
+  if (process_waitpid (child_tid, &status, false) == TID_ERROR)
+    return -1;
+  return status;
+}
 
-  c->parent_is_waiting = true;
+/* Frees C, a dead child of the current thread, and returns its
+   exit status.  If C is a process, the caller must already have
+   taken C's unit of child_exited. */
+static int
+reap_child (struct child *c) 
+{
+  struct thread *cur = thread_current ();
+  int exit_status = c->exit_status;
+  enum intr_level old_level;
 
-  /*	제대로 된 구현 전 테스트 코드 
-  int i;
-  for(i=0; i<3000000000; i++);
-  */
-  
-  while(true)
-  {
-	  if(c->is_zombie == true)
-	  {
-		  int exit_status = c->exit_status;
-	  	  list_remove(&c->child_elem);
-		  free(c);
-		  return exit_status;
-	  }
-	  enum intr_level old_level;
-	  old_level = intr_disable(); 
-	  thread_block();
-	  intr_set_level(old_level);
-  } 
+  old_level = intr_disable ();
+  list_remove (&c->child_elem);
+  if (c->is_process)
+    {
+      list_remove (&c->exit_elem);
+      cur->child_cnt--;
+    }
+  intr_set_level (old_level);
+
+  child_free (c);
+  return exit_status;
+}
+
+/* Downs SEMA, which dying children of the current thread up,
+   unless the current process starts going down first.  Returns
+   false in that case. */
+static bool
+wait_child (struct semaphore *sema)
+{
+  struct thread *cur = thread_current ();
+  struct wait_entry child_e, exit_e;
+  struct waiter w;
+  bool success;
+
+  waiter_init (&w);
+  wait_queue_add (&cur->child_queue, &child_e, &w);
+  process_poll_exit (&exit_e, &w);
+  while (!(success = sema_try_down (sema)) && !process_poll_exit (NULL, NULL))
+    waiter_sleep (&w, -1);
+  wait_queue_remove (&exit_e);
+  wait_queue_remove (&child_e);
+  return success;
+}
+
+/* Waits for the child thread CHILD_TID to die, or for any child
+   process to die if CHILD_TID is -1, and stores its exit status
+   in *STATUS.  With NOHANG, does not wait: returns 0 if no such
+   child has died yet.  Returns the dead child's tid, or
+   TID_ERROR if there is no such child, CHILD_TID has already
+   been waited for, or the current process starts going down
+   while waiting.
+
+   Dead child processes are queued on exited_children in the
+   order they die, so waiting for any of them takes O(1) time
+   however many children there are. */
+tid_t
+process_waitpid (tid_t child_tid, int *status, bool nohang) 
+{
+  struct thread *cur = thread_current ();
+  struct child *c;
+
+  if (child_tid == -1)
+    {
+      if (cur->child_cnt == 0)
+        return TID_ERROR;
+      if (nohang)
+        {
+          if (!sema_try_down (&cur->child_exited))
+            return 0;
+        }
+      else if (!wait_child (&cur->child_exited))
+        return TID_ERROR;
+      c = list_entry (list_front (&cur->exited_children),
+                      struct child, exit_elem);
+    }
+  else
+    {
+      c = get_child (child_tid);
+      if (c == NULL)		// TID is invalid or not a child
+        return TID_ERROR;
+      if (c->parent_is_waiting)	// process_wait() has already called
+        return TID_ERROR;
+      if (nohang && !c->is_zombie)
+        return 0;
+
+      c->parent_is_waiting = true;
+      if (!wait_child (&c->exited))
+        return TID_ERROR;
+      if (c->is_process && !sema_try_down (&cur->child_exited))
+        NOT_REACHED ();
+    }
+
+  child_tid = c->tid;
+  *status = reap_child (c);
+  return child_tid;
 }
 
 /* Free the current process's resources. */
@@ -219,34 +835,57 @@ process_exit (void)
   struct thread *cur = thread_current ();
   uint32_t *pd;
 
-  // Close all files
-  close_all();
+  // user threads share the files and the page directory of the leader
+  if(cur->leader == NULL)
+  {
+	  // 다른 user thread들을 먼저 끝냄
+	  kill_uthreads(cur);
+	  // Close all files
+	  close_all();
+	  // 공유 메모리 mapping은 page directory와 함께 정리됨
+	  shm_detach_all();
+  }
   // Close directory
   dir_close(thread_current()->directory);
 
   // 모종의 이유로 인해 parent가 먼저 종료된다면, process_wait에서 child free가 안되므로
   struct list_elem *e = list_begin(&cur->child_list);
   struct list_elem *next;
+  enum intr_level old_level;
   while(e != list_end(&cur->child_list))
   {
 	  next = list_next(e);	// syscall.c close_all() 처럼 free할 것이므로 저장해놓아야 함
 	  struct child *c = list_entry(e, struct child, child_elem);
-	  c->self->myself = NULL;
+	  // zombie의 thread는 이미 없어졌을 수 있음
+	  old_level = intr_disable();
+	  if(!c->is_zombie)
+		  c->self->myself = NULL;
 	  list_remove(&c->child_elem);
-	  free(c);
+	  intr_set_level(old_level);
+	  child_free(c);
 	  e = next; 
   }
 
+  old_level = intr_disable();
   if(cur->myself != NULL && cur->myself->parent != NULL)
   {
-	  // wake up parent, if blocked
-	  // printf("%d %d / parent %d %d\n", cur->tid, cur->status, cur->parent->tid, cur->parent->status);
-	  cur->myself->is_zombie = true;
-	  if(cur->myself->parent_is_waiting && cur->myself->parent->status == THREAD_BLOCKED)
+	  // wake up parent, if waiting for this child or for any child process
+	  struct child *c = cur->myself;
+	  c->is_zombie = true;
+	  if(c->is_process)
 	  {
-		  thread_unblock(cur->myself->parent);
-		  //thread_yield();
+		  list_push_back(&c->parent->exited_children, &c->exit_elem);
+		  sema_up(&c->parent->child_exited);
 	  }
+	  sema_up(&c->exited);
+	  wait_queue_wake(&c->parent->child_queue);
+  }
+  intr_set_level(old_level);
+
+  if(cur->leader != NULL)
+  {
+	  release_uthread(cur);
+	  return;
   }
 
   /* Destroy the current process's page directory and switch back
@@ -348,41 +987,27 @@ struct Elf32_Phdr
 
 static bool setup_stack (void **esp);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
-static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
+static bool load_segment (struct elf_image *image, struct file *file,
+                          off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
                           bool writable);
+static bool install_page (void *upage, void *kpage, bool writable);
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
-   Stores the executable's entry point into *EIP
-   and its initial stack pointer into *ESP.
-   Returns true if successful, false otherwise. */
-bool
-load (const char *file_name, void (**eip) (void), void **esp) 
+/* Reads the executable FILE, which is named FILE_NAME in error
+   messages, into a new image that is not cached yet.
+   Returns the image, or a null pointer if FILE is not a valid
+   executable or a memory allocation or disk read error
+   occurs. */
+static struct elf_image *
+read_image (const char *file_name, struct file *file) 
 {
-  struct thread *t = thread_current ();
+  struct elf_image *image;
   struct Elf32_Ehdr ehdr;
-  struct file *file = NULL;
   off_t file_ofs;
-  bool success = false;
   int i;
 
-  /* Allocate and activate page directory. */
-  t->pagedir = pagedir_create ();
-  if (t->pagedir == NULL) 
-    goto done;
-  process_activate ();
-
-  /* Open executable file. */
-  lock_acquire(&fl);
-  file = filesys_open (file_name);
-  if (file == NULL) 
-    {
-      printf ("load: %s: open failed\n", file_name);
-      goto done; 
-    }
-
   /* Read and verify executable header. */
-  if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
+  if (file_read_at (file, &ehdr, sizeof ehdr, 0) != sizeof ehdr
       || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7)
       || ehdr.e_type != 2
       || ehdr.e_machine != 3
@@ -391,9 +1016,13 @@ load (const char *file_name, void (**eip) (void), void **esp)
       || ehdr.e_phnum > 1024) 
     {
       printf ("load: %s: error loading executable\n", file_name);
-      goto done; 
+      return NULL; 
     }
 
+  image = elf_image_create (file_get_inode (file));
+  if (image == NULL)
+    return NULL;
+
   /* Read program headers. */
   file_ofs = ehdr.e_phoff;
   for (i = 0; i < ehdr.e_phnum; i++) 
@@ -401,11 +1030,9 @@ load (const char *file_name, void (**eip) (void), void **esp)
       struct Elf32_Phdr phdr;
 
       if (file_ofs < 0 || file_ofs > file_length (file))
-        goto done;
-      file_seek (file, file_ofs);
-
-      if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-        goto done;
+        goto fail;
+      if (file_read_at (file, &phdr, sizeof phdr, file_ofs) != sizeof phdr)
+        goto fail;
       file_ofs += sizeof phdr;
       switch (phdr.p_type) 
         {
@@ -419,7 +1046,7 @@ load (const char *file_name, void (**eip) (void), void **esp)
         case PT_DYNAMIC:
         case PT_INTERP:
         case PT_SHLIB:
-          goto done;
+          goto fail;
         case PT_LOAD:
           if (validate_segment (&phdr, file)) 
             {
@@ -443,35 +1070,124 @@ load (const char *file_name, void (**eip) (void), void **esp)
                   read_bytes = 0;
                   zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
                 }
-              if (!load_segment (file, file_page, (void *) mem_page,
+              if (!load_segment (image, file, file_page, (void *) mem_page,
                                  read_bytes, zero_bytes, writable))
-                goto done;
+                goto fail;
             }
           else
-            goto done;
+            goto fail;
           break;
         }
     }
 
-  /* Set up stack. */
-  if (!setup_stack (esp))
+  /* Start address. */
+  image->entry = (void (*) (void)) ehdr.e_entry;
+  return image;
+
+ fail:
+  elf_image_release (image);
+  return NULL;
+}
+
+/* Obtains a page from the user pool with palloc_get_page() and
+   FLAGS, flushing the executable image cache to make room if the
+   pool is exhausted.  Returns a null pointer if there is still
+   no page. */
+static void *
+get_user_page (enum palloc_flags flags)
+{
+  void *kpage = palloc_get_page (PAL_USER | flags);
+  if (kpage == NULL && elfcache_flush ())
+    kpage = palloc_get_page (PAL_USER | flags);
+  return kpage;
+}
+
+/* Maps the pages of IMAGE into the current process.  Pages with
+   contents share IMAGE's frames, copy-on-write if they are
+   writable; the others get new zeroed pages.
+   Returns true if successful, false if UPAGE is already mapped
+   or if memory allocation fails. */
+static bool
+map_image (const struct elf_image *image) 
+{
+  struct thread *t = thread_current ();
+  size_t i;
+
+  for (i = 0; i < image->page_cnt; i++)
+    {
+      const struct image_page *p = &image->pages[i];
+
+      if (p->kpage != NULL)
+        {
+          if (!pagedir_share_page (t->pagedir, p->upage, p->kpage,
+                                   p->writable))
+            return false;
+        }
+      else
+        {
+          uint8_t *kpage = get_user_page (PAL_ZERO);
+          if (kpage == NULL)
+            return false;
+          if (!install_page (p->upage, kpage, p->writable))
+            {
+              palloc_free_page (kpage);
+              return false;
+            }
+        }
+    }
+  return true;
+}
+
+/* Loads an ELF executable from FILE, which is named FILE_NAME in
+   error messages, into the current thread.  The parsed image is
+   kept in the executable cache, so that loading the same file
+   again neither parses it nor reads it from disk.
+   Stores the executable's entry point into *EIP
+   and its initial stack pointer into *ESP.
+   Returns true if successful, false otherwise. */
+bool
+load (const char *file_name, struct file *file,
+      void (**eip) (void), void **esp) 
+{
+  struct thread *t = thread_current ();
+  struct elf_image *image;
+  bool success = false;
+
+  lock_acquire(&fl);
+
+  /* Allocate and activate page directory. */
+  t->pagedir = pagedir_create ();
+  if (t->pagedir == NULL) 
     goto done;
+  process_activate ();
 
-  /* Start address. */
-  *eip = (void (*) (void)) ehdr.e_entry;
+  /* Find the executable's image, or read it. */
+  image = elfcache_lookup (file_get_inode (file));
+  if (image == NULL)
+    {
+      image = read_image (file_name, file);
+      if (image == NULL)
+        goto done;
+      elfcache_insert (image);
+    }
 
-  success = true;
+  /* Map it and set up stack. */
+  if (map_image (image) && setup_stack (esp))
+    {
+      /* Start address. */
+      *eip = image->entry;
+      success = true;
+    }
+  elf_image_release (image);
 
  done:
-  /* We arrive here whether the load is successful or not. */
-  file_close (file);
+  /* We arrive here whether the load is successful or not.
+     The caller owns FILE and closes it. */
   lock_release(&fl);
   return success;
 }
-
-/* load() helpers. */
 
-static bool install_page (void *upage, void *kpage, bool writable);
+/* load() helpers. */
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -518,29 +1234,31 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
   return true;
 }
 
-/* Loads a segment starting at offset OFS in FILE at address
-   UPAGE.  In total, READ_BYTES + ZERO_BYTES bytes of virtual
-   memory are initialized, as follows:
+/* Reads a segment starting at offset OFS in FILE, to be mapped
+   at address UPAGE, into IMAGE.  In total, READ_BYTES +
+   ZERO_BYTES bytes of virtual memory are initialized, as
+   follows:
 
         - READ_BYTES bytes at UPAGE must be read from FILE
           starting at offset OFS.
 
         - ZERO_BYTES bytes at UPAGE + READ_BYTES must be zeroed.
 
-   The pages initialized by this function must be writable by the
-   user process if WRITABLE is true, read-only otherwise.
+   Pages that are zeroed entirely are not allocated until the
+   image is mapped.  The pages must be writable by the user
+   process if WRITABLE is true, read-only otherwise.
 
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
 static bool
-load_segment (struct file *file, off_t ofs, uint8_t *upage,
-              uint32_t read_bytes, uint32_t zero_bytes, bool writable) 
+load_segment (struct elf_image *image, struct file *file, off_t ofs,
+              uint8_t *upage, uint32_t read_bytes, uint32_t zero_bytes,
+              bool writable) 
 {
   ASSERT ((read_bytes + zero_bytes) % PGSIZE == 0);
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
 
-  file_seek (file, ofs);
   while (read_bytes > 0 || zero_bytes > 0) 
     {
       /* Calculate how to fill this page.
@@ -548,22 +1266,27 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
          and zero the final PAGE_ZERO_BYTES bytes. */
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
+      uint8_t *kpage = NULL;
 
-      /* Get a page of memory. */
-      uint8_t *kpage = palloc_get_page (PAL_USER);
-      if (kpage == NULL)
-        return false;
-
-      /* Load this page. */
-      if (file_read (file, kpage, page_read_bytes) != (int) page_read_bytes)
+      if (page_read_bytes > 0)
         {
-          palloc_free_page (kpage);
-          return false; 
+          /* Get a page of memory. */
+          kpage = get_user_page (0);
+          if (kpage == NULL)
+            return false;
+
+          /* Load this page. */
+          if (file_read_at (file, kpage, page_read_bytes, ofs)
+              != (int) page_read_bytes)
+            {
+              palloc_free_page (kpage);
+              return false; 
+            }
+          memset (kpage + page_read_bytes, 0, page_zero_bytes);
         }
-      memset (kpage + page_read_bytes, 0, page_zero_bytes);
 
-      /* Add the page to the process's address space. */
-      if (!install_page (upage, kpage, writable)) 
+      /* Add the page to the image. */
+      if (!elf_image_add_page (image, upage, kpage, writable)) 
         {
           palloc_free_page (kpage);
           return false; 
@@ -572,6 +1295,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       /* Advance. */
       read_bytes -= page_read_bytes;
       zero_bytes -= page_zero_bytes;
+      ofs += page_read_bytes;
       upage += PGSIZE;
     }
   return true;
@@ -585,7 +1309,7 @@ setup_stack (void **esp)
   uint8_t *kpage;
   bool success = false;
 
-  kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+  kpage = get_user_page (PAL_ZERO);
   if (kpage != NULL) 
     {
       success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);
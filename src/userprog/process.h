@@ -1,11 +1,47 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <spawn.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
 #include "threads/thread.h"
 
+/* Maximum number of user threads per process, besides the main
+   thread.  Each one gets a one-page user stack. */
+#define UTHREAD_MAX 32
+
+/* Argument and environment strings of a new process, packed
+   into one page so that each child can copy them onto its stack
+   with a single memcpy(). */
+struct arg_block
+  {
+    int argc;                   /* Number of arguments. */
+    int cnt;                    /* Arguments plus environment strings. */
+    size_t size;                /* Bytes used in STRINGS. */
+    uint16_t ofs[SPAWN_ARG_MAX]; /* Start of each string in STRINGS. */
+    char strings[];             /* Arguments, then the environment. */
+  };
+
+struct arg_block *arg_block_create (void);
+bool arg_block_add (struct arg_block *, const char *, size_t len);
+void arg_block_destroy (struct arg_block *);
+
 tid_t process_execute (const char *file_name);
+int process_spawn (const char *file_name, const struct arg_block *,
+                   const struct spawn_fd *, int fd_cnt, tid_t tids[], int n);
+tid_t process_fork (const struct intr_frame *);
 int process_wait (tid_t);
+tid_t process_waitpid (tid_t, int *status, bool nohang);
 void process_exit (void);
 void process_activate (void);
 
+tid_t process_create_thread (void (*start) (void), void *func, void *arg);
+void process_kill (int status) NO_RETURN;
+void process_check_killed (void);
+bool process_poll_exit (struct wait_entry *, struct waiter *);
+bool process_pin_user (const void *uaddr, size_t size, bool write);
+void process_unpin_user (void);
+bool process_copy_out (void *udst, const void *src, size_t size);
+
 #endif /* userprog/process.h */
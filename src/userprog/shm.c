@@ -0,0 +1,317 @@
+#include "userprog/shm.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include "lib/user/syscall.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+
+/* Shared memory segments.
+
+   A segment is a named set of zeroed frames that any process can
+   map into its address space, where writes by one process are
+   seen by all others.  Segments live until they are removed by
+   name and unmapped everywhere, whichever happens last.  Mappings
+   are inherited by fork() and dropped when the process exits.
+
+   Segments are mapped in a window of the address space well
+   above any executable and below the user stacks, at the lowest
+   address where they fit. */
+#define SHM_BASE ((uint8_t *) 0x80000000)
+#define SHM_END ((uint8_t *) PHYS_BASE - 0x10000000)
+#define SHM_MAX_PAGES 1024      /* Largest segment, in pages. */
+
+/* A shared memory segment. */
+struct shm_segment
+  {
+    struct list_elem elem;      /* Element in SEGMENTS, while named. */
+    char name[SHM_NAME_MAX + 1];        /* Name. */
+    int ref_cnt;                /* Mappings, plus one while named. */
+    size_t page_cnt;            /* Number of elements in KPAGES. */
+    void **kpages;              /* Frames, from the user pool. */
+  };
+
+/* A segment mapped into a process. */
+struct shm_mapping
+  {
+    struct list_elem elem;      /* Element in the process's shm_maps. */
+    struct shm_segment *seg;    /* Segment. */
+    uint8_t *addr;              /* User address of its first page. */
+  };
+
+static struct list segments;    /* Named segments. */
+static struct lock shm_lock;    /* Protects segments and mappings. */
+
+/* Initializes shared memory. */
+void
+shm_init (void)
+{
+  list_init (&segments);
+  lock_init (&shm_lock);
+}
+
+/* Returns the segment called NAME, or a null pointer if there is
+   none.  Must be called with shm_lock held. */
+static struct shm_segment *
+segment_lookup (const char *name)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&segments); e != list_end (&segments);
+       e = list_next (e))
+    {
+      struct shm_segment *seg = list_entry (e, struct shm_segment, elem);
+      if (!strcmp (seg->name, name))
+        return seg;
+    }
+  return NULL;
+}
+
+/* Drops a reference to SEG, freeing it and giving up its frames
+   when that was the last.  Must be called with shm_lock held. */
+static void
+segment_put (struct shm_segment *seg)
+{
+  size_t i;
+
+  if (--seg->ref_cnt > 0)
+    return;
+  for (i = 0; i < seg->page_cnt; i++)
+    pagedir_release_frame (seg->kpages[i]);
+  free (seg->kpages);
+  free (seg);
+}
+
+/* Creates a segment called NAME of PAGE_CNT zeroed pages, holding
+   the reference of its name.  Returns the segment, or a null
+   pointer if memory is exhausted.  Must be called with shm_lock
+   held. */
+static struct shm_segment *
+segment_create (const char *name, size_t page_cnt)
+{
+  struct shm_segment *seg = malloc (sizeof *seg);
+
+  if (seg == NULL)
+    return NULL;
+  seg->kpages = malloc (page_cnt * sizeof *seg->kpages);
+  if (seg->kpages == NULL)
+    {
+      free (seg);
+      return NULL;
+    }
+  strlcpy (seg->name, name, sizeof seg->name);
+  seg->ref_cnt = 1;
+  for (seg->page_cnt = 0; seg->page_cnt < page_cnt; seg->page_cnt++)
+    {
+      void *kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+      if (kpage == NULL)
+        {
+          segment_put (seg);
+          return NULL;
+        }
+      seg->kpages[seg->page_cnt] = kpage;
+    }
+  list_push_back (&segments, &seg->elem);
+  return seg;
+}
+
+/* Finds the lowest address in the shared memory window of LEADER
+   with room for PAGE_CNT pages.  Returns it and sets *NEXT to the
+   mapping the new one goes before, or returns a null pointer if
+   there is no room.  Must be called with shm_lock held. */
+static uint8_t *
+find_room (struct thread *leader, size_t page_cnt, struct list_elem **next)
+{
+  uint8_t *addr = SHM_BASE;
+  size_t size = page_cnt * PGSIZE;
+  struct list_elem *e;
+
+  for (e = list_begin (&leader->shm_maps); e != list_end (&leader->shm_maps);
+       e = list_next (e))
+    {
+      struct shm_mapping *m = list_entry (e, struct shm_mapping, elem);
+      if ((size_t) (m->addr - addr) >= size)
+        break;
+      addr = m->addr + m->seg->page_cnt * PGSIZE;
+    }
+
+  *next = e;
+  return (size_t) (SHM_END - addr) >= size ? addr : NULL;
+}
+
+/* Maps the segment called NAME into the current process and
+   returns its address.  If there is no such segment and SIZE is
+   nonzero, one of SIZE bytes, rounded up to whole pages, is
+   created first.  Returns a null pointer if NAME is not a valid
+   name, the segment is smaller than SIZE, or memory or address
+   space is exhausted. */
+void *
+shm_attach (const char *name, size_t size)
+{
+  struct thread *leader = thread_leader (thread_current ());
+  uint32_t *pd = thread_current ()->pagedir;
+  size_t page_cnt = DIV_ROUND_UP (size, PGSIZE);
+  struct shm_segment *seg;
+  struct shm_mapping *m;
+  struct list_elem *next;
+  bool created = false;
+  uint8_t *addr = NULL;
+  size_t i;
+
+  if (name[0] == '\0' || strlen (name) > SHM_NAME_MAX
+      || page_cnt > SHM_MAX_PAGES)
+    return NULL;
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return NULL;
+
+  lock_acquire (&shm_lock);
+  seg = segment_lookup (name);
+  if (seg == NULL && page_cnt > 0)
+    {
+      seg = segment_create (name, page_cnt);
+      created = seg != NULL;
+    }
+  if (seg != NULL && seg->page_cnt >= page_cnt)
+    addr = find_room (leader, seg->page_cnt, &next);
+
+  if (addr != NULL)
+    for (i = 0; i < seg->page_cnt; i++)
+      if (!pagedir_map_shared (pd, addr + i * PGSIZE, seg->kpages[i]))
+        {
+          while (i-- > 0)
+            pagedir_free_page (pd, addr + i * PGSIZE);
+          addr = NULL;
+          break;
+        }
+
+  if (addr != NULL)
+    {
+      seg->ref_cnt++;
+      m->seg = seg;
+      m->addr = addr;
+      list_insert (next, &m->elem);
+    }
+  else
+    {
+      if (created)
+        {
+          list_remove (&seg->elem);
+          segment_put (seg);
+        }
+      free (m);
+    }
+  lock_release (&shm_lock);
+  return addr;
+}
+
+/* Unmaps the segment mapped at ADDR from the current process.
+   Returns false if no segment is mapped there. */
+bool
+shm_detach (void *addr)
+{
+  struct thread *leader = thread_leader (thread_current ());
+  uint32_t *pd = thread_current ()->pagedir;
+  struct list_elem *e;
+  bool found = false;
+
+  /* Other threads of the process may be copying through these
+     pages in a system call. */
+  rwlock_write_acquire (&leader->user_mem);
+  lock_acquire (&shm_lock);
+  for (e = list_begin (&leader->shm_maps); e != list_end (&leader->shm_maps);
+       e = list_next (e))
+    {
+      struct shm_mapping *m = list_entry (e, struct shm_mapping, elem);
+      if (m->addr == addr)
+        {
+          size_t i;
+
+          for (i = 0; i < m->seg->page_cnt; i++)
+            pagedir_free_page (pd, m->addr + i * PGSIZE);
+          list_remove (&m->elem);
+          segment_put (m->seg);
+          free (m);
+          found = true;
+          break;
+        }
+    }
+  lock_release (&shm_lock);
+  rwlock_write_release (&leader->user_mem);
+  return found;
+}
+
+/* Removes the name of segment NAME, so that shm_attach() creates
+   a new segment by that name.  The segment itself lives on until
+   it is unmapped everywhere.  Returns false if there is no such
+   segment. */
+bool
+shm_remove (const char *name)
+{
+  struct shm_segment *seg;
+
+  lock_acquire (&shm_lock);
+  seg = segment_lookup (name);
+  if (seg != NULL)
+    {
+      list_remove (&seg->elem);
+      segment_put (seg);
+    }
+  lock_release (&shm_lock);
+  return seg != NULL;
+}
+
+/* Gives the current process, right after fork(), the mappings of
+   PARENT.  pagedir_fork() already mapped their pages.  Returns
+   false if memory runs out. */
+bool
+shm_inherit (struct thread *parent)
+{
+  struct thread *t = thread_current ();
+  struct list_elem *e;
+  bool success = true;
+
+  lock_acquire (&shm_lock);
+  for (e = list_begin (&parent->shm_maps); e != list_end (&parent->shm_maps);
+       e = list_next (e))
+    {
+      struct shm_mapping *pm = list_entry (e, struct shm_mapping, elem);
+      struct shm_mapping *m = malloc (sizeof *m);
+
+      if (m == NULL)
+        {
+          success = false;
+          break;
+        }
+      m->seg = pm->seg;
+      m->addr = pm->addr;
+      m->seg->ref_cnt++;
+      list_push_back (&t->shm_maps, &m->elem);
+    }
+  lock_release (&shm_lock);
+  return success;
+}
+
+/* Drops every mapping of the current process, which is exiting.
+   The pages themselves go away with its page directory. */
+void
+shm_detach_all (void)
+{
+  struct thread *t = thread_current ();
+
+  lock_acquire (&shm_lock);
+  while (!list_empty (&t->shm_maps))
+    {
+      struct shm_mapping *m = list_entry (list_pop_front (&t->shm_maps),
+                                          struct shm_mapping, elem);
+      segment_put (m->seg);
+      free (m);
+    }
+  lock_release (&shm_lock);
+}
@@ -0,0 +1,16 @@
+#ifndef USERPROG_SHM_H
+#define USERPROG_SHM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct thread;
+
+void shm_init (void);
+void *shm_attach (const char *name, size_t size);
+bool shm_detach (void *addr);
+bool shm_remove (const char *name);
+bool shm_inherit (struct thread *parent);
+void shm_detach_all (void);
+
+#endif /* userprog/shm.h */
@@ -1,5 +1,6 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
@@ -8,17 +9,29 @@
 #include "userprog/pagedir.h"
 #include "filesys/filesys.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/memprof.h"
+#include "threads/slab.h"
 #include "filesys/file.h"
 #include "devices/input.h"
+#include "devices/timer.h"
+#include "threads/waitq.h"
 #include "process.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "userprog/futex.h"
+#include "userprog/elfcache.h"
+#include "userprog/pipe.h"
+#include "userprog/shm.h"
 
 static void syscall_handler (struct intr_frame *);
 
 void is_valid_pointer(void *ptr);
 void *convert_userp(void *ptr);
 void get_argument(struct intr_frame *f, int *argument, int n);
+static void check_user_buffer(const void *buf, size_t size);
+static void check_user_writable(void *buf, size_t size);
+static void check_user_writable_lazy(void *buf, size_t size);
 struct file *get_file(int fd);
 
 struct custom_file // mapping file and fd
@@ -28,12 +41,17 @@ struct custom_file // mapping file and fd
 	struct file *f;
 	struct dir *d;
 	int is_dir;  // struct inode에서 byte 수 맞추기 위해 bool 대신 쓴 것을 고대로 씀
+	struct pipe *pipe;		// pipe의 한쪽 끝이면 f, d는 NULL
+	enum pipe_end end;		// pipe의 어느 쪽 끝인지
 };
 
-struct custom_file *get_custom_file(int fd);
-struct custom_file *get_custom_file(int fd)
+/* Cache of struct custom_file. */
+static struct slab_cache custom_file_cache;
+
+/* Looks FD up in file list L.  Must be called with fl held. */
+static struct custom_file *
+find_custom_file(struct list *l, int fd)
 {
-	struct list *l = &thread_current()->file_list;
 	struct list_elem *e;
 
 	for(e = list_begin(l); e != list_end(l); e = list_next(e))
@@ -45,6 +63,18 @@ struct custom_file *get_custom_file(int fd)
 	return NULL;
 }
 
+struct custom_file *get_custom_file(int fd);
+struct custom_file *get_custom_file(int fd)
+{
+	// file_list는 같은 process의 user thread들이 공유하므로 fl 안에서 탐색
+	struct custom_file *found;
+
+	lock_acquire(&fl);
+	found = find_custom_file(&thread_leader(thread_current())->file_list, fd);
+	lock_release(&fl);
+	return found;
+}
+
 struct file *get_file(int fd)
 {
 	struct custom_file *cf = get_custom_file(fd);
@@ -57,6 +87,10 @@ void
 syscall_init (void)
 {
   lock_init(&fl);
+  slab_cache_init(&custom_file_cache, "custom_file", sizeof(struct custom_file), NULL);
+  futex_init();
+  elfcache_init();
+  shm_init();
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
@@ -68,6 +102,9 @@ syscall_handler (struct intr_frame *f)
 
 	is_valid_pointer(esp);
 
+	// process가 종료 중이면 user thread는 여기서 끝냄
+	process_check_killed();
+
 	nsyscall = *(esp++);
 	//printf("syscall [%d]\n", nsyscall);
 	switch(nsyscall)
@@ -109,12 +146,10 @@ syscall_handler (struct intr_frame *f)
 			break;
     	case SYS_READ:                   /* Read from a file. */
 			get_argument(f, args, 3);
-			args[1] = (int)convert_userp((void *)args[1]);
 			ret = read(args[0], (void *)args[1], (unsigned)args[2]);
 			break;
     	case SYS_WRITE:                  /* Write to a file. */
     		get_argument(f, args, 3);
-			args[1] = (int)convert_userp((void *)args[1]);
 			ret = write(args[0], (const void *)args[1], (unsigned)args[2]);
 			break;
 		case SYS_SEEK:                   /* Change position in a file. */
@@ -143,6 +178,7 @@ syscall_handler (struct intr_frame *f)
 			break;
 		case SYS_READDIR:                /* Reads a directory entry. */
 			get_argument(f, args, 2);
+			check_user_writable((void *)args[1], READDIR_MAX_LEN + 1);
 			args[1] = (int)convert_userp((void *)args[1]);
 			ret = readdir(args[0], (void *)args[1]);
 			break;
@@ -154,6 +190,75 @@ syscall_handler (struct intr_frame *f)
 			get_argument(f, args, 1);
 			ret = inumber(args[0]);
 			break;
+
+		case SYS_SCHED_SETCLASS:         /* Change the scheduling class. */
+			get_argument(f, args, 2);
+			ret = sched_setclass(args[0], args[1]);
+			break;
+		case SYS_SCHED_GETCLASS:         /* Report the scheduling class. */
+			ret = sched_getclass();
+			break;
+
+		case SYS_FUTEX_WAIT:             /* Sleep while a word holds a value. */
+			get_argument(f, args, 2);
+			ret = futex_wait((int *)args[0], args[1]);
+			break;
+		case SYS_FUTEX_WAKE:             /* Wake threads sleeping on a word. */
+			get_argument(f, args, 2);
+			ret = futex_wake((int *)args[0], args[1]);
+			break;
+
+		case SYS_UTHREAD_CREATE:         /* Start a thread in this process. */
+			get_argument(f, args, 3);
+			ret = create_uthread((void *)args[0], (void *)args[1], (void *)args[2]);
+			break;
+		case SYS_UTHREAD_JOIN:           /* Wait for a thread to exit. */
+			get_argument(f, args, 1);
+			ret = uthread_join(args[0]);
+			break;
+		case SYS_UTHREAD_EXIT:           /* Terminate this thread. */
+			get_argument(f, args, 1);
+			uthread_exit(args[0]);
+			break;
+
+		case SYS_SPAWN:                  /* Start several processes at once. */
+			get_argument(f, args, 3);
+			ret = spawn((const struct spawn_args *)args[0], args[1], (pid_t *)args[2]);
+			break;
+		case SYS_FORK:                   /* Duplicate this process. */
+			ret = process_fork(f);
+			break;
+		case SYS_WAITPID:                /* Wait for a child, or any child, to die. */
+			get_argument(f, args, 3);
+			ret = waitpid(args[0], (int *)args[1], args[2]);
+			break;
+		case SYS_PIPE:                   /* Create a pipe. */
+			get_argument(f, args, 1);
+			ret = pipe((int *)args[0]);
+			break;
+		case SYS_POLL:                   /* Wait for descriptors to become ready. */
+			get_argument(f, args, 3);
+			ret = poll((struct pollfd *)args[0], args[1], args[2]);
+			break;
+		case SYS_CONSOLE_MODE:           /* Set the console input mode. */
+			get_argument(f, args, 1);
+			ret = console_mode(args[0]);
+			break;
+		case SYS_SHM_MAP:                /* Map a shared memory segment. */
+			get_argument(f, args, 2);
+			ret = (int)shm_map((const char *)args[0], (size_t)args[1]);
+			break;
+		case SYS_SHM_UNMAP:              /* Unmap a shared memory segment. */
+			get_argument(f, args, 1);
+			ret = shm_unmap((void *)args[0]);
+			break;
+		case SYS_SHM_UNLINK:             /* Remove a shared memory segment's name. */
+			get_argument(f, args, 1);
+			ret = shm_unlink((const char *)args[0]);
+			break;
+		case SYS_MEMPROF:                /* Print the kernel memory profile. */
+			memprof();
+			break;
 		default:
 			thread_exit();
 	}
@@ -186,6 +291,76 @@ void *convert_userp(void *ptr)
 	return pagedir_get_page(thread_current()->pagedir, ptr);
 }
 
+/* Checks every page of the SIZE bytes at BUF, like is_valid_pointer(). */
+static void
+check_user_buffer(const void *buf, size_t size)
+{
+	const uint8_t *p = buf;
+	const uint8_t *end = p + size;
+
+	if(size == 0)
+		return;
+	if(end < p)
+		exit(-1);
+	is_valid_pointer((void *)p);
+	for(p = pg_round_down(p) + PGSIZE; p < end; p += PGSIZE)
+		is_valid_pointer((void *)p);
+}
+
+/* Checks the SIZE bytes at BUF like check_user_buffer(), and
+   also that the process may write them.  Gives the process its
+   own copy of any of those pages it shares copy-on-write, since
+   the kernel writes them through its own mapping of the frames
+   and would not fault.  Read-only pages, such as code shared
+   with other processes, are refused the same way. */
+static void
+check_user_writable(void *buf, size_t size)
+{
+	uint32_t *pd = thread_current()->pagedir;
+	uint8_t *p = buf;
+	uint8_t *end = p + size;
+
+	check_user_buffer(buf, size);
+	for(; p < end; p = pg_round_down(p) + PGSIZE)
+	{
+		if(pagedir_is_cow(pd, p) && !pagedir_copy_on_write(pd, p))
+			exit(-1);
+		if(!pagedir_is_writable(pd, p))
+			exit(-1);
+	}
+}
+
+/* Checks the SIZE bytes at BUF like check_user_writable(), but
+   leaves pages the process shares copy-on-write shared.  Only
+   for buffers the kernel writes through user addresses, which
+   fault and get copied then, if they are written at all. */
+static void
+check_user_writable_lazy(void *buf, size_t size)
+{
+	uint32_t *pd = thread_current()->pagedir;
+	uint8_t *p = buf;
+	uint8_t *end = p + size;
+
+	check_user_buffer(buf, size);
+	for(; p < end; p = pg_round_down(p) + PGSIZE)
+		if(!pagedir_is_writable(pd, p) && !pagedir_is_cow(pd, p))
+			exit(-1);
+}
+
+/* Checks the null-terminated string at STR like
+   is_valid_pointer() and returns its length. */
+static size_t
+user_strlen(const char *str)
+{
+	const char *p = str;
+
+	is_valid_pointer((void *)p);
+	while(*p != '\0')
+		if(pg_ofs(++p) == 0)
+			is_valid_pointer((void *)p);
+	return p - str;
+}
+
 void get_argument(struct intr_frame *f, int *argument, int n)
 {
 	int i;
@@ -207,6 +382,11 @@ void
 exit (int status)
 {
 	struct thread *t = thread_current();
+
+	// user thread의 exit은 process 전체를 끝냄, 출력은 leader가 함
+	if(t->leader != NULL)
+		process_kill(status);
+
 	t->myself->exit_status = status;
 	printf("%s: exit(%d)\n", t->name, status);
 	thread_exit();
@@ -215,39 +395,199 @@ exit (int status)
 
 pid_t exec (const char *file) // with parameters
 {
-	pid_t ret = process_execute(file);
-	if(ret == -1)	// openTest 실패 시 바로 리턴
-		return ret;
-
-	struct child *c = get_child(ret);
 	// memory 때문에 exec 파일 로딩에 실패할 때
-	// filesys_open (openTest) 까지는 되지만, process.c의 load()가 실패함
-	// 따라서 이것까지 기다렸다가 exec의 결과를 리턴할 수밖에 없음
-	while(c->load_status == 0)
+	// filesys_open 까지는 되지만, process.c의 load()가 실패함
+	// 따라서 process_execute는 child가 load를 마칠 때까지 잠들었다가 리턴
+	return process_execute(file);
+}
+
+pid_t
+waitpid (pid_t pid, int *status, int options)
+{
+	int exit_status;
+	pid_t ret;
+
+	if(status != NULL)
+		check_user_writable(status, sizeof *status);
+
+	// pid가 -1이면 먼저 종료된 아무 child process
+	ret = process_waitpid(pid, &exit_status, (options & WNOHANG) != 0);
+	if(ret > 0 && status != NULL)
+		*status = exit_status;
+	return ret;
+}
+
+/* Appends the null-terminated array of user strings VEC to ARGS. */
+static bool
+add_user_strings(struct arg_block *args, char *const *vec)
+{
+	for(;; vec++)
 	{
-		thread_yield();
+		check_user_buffer(vec, sizeof *vec);
+		if(*vec == NULL)
+			return true;
+		if(!arg_block_add(args, *vec, user_strlen(*vec)))
+			return false;
 	}
+}
 
-	if(c->load_status == -1)
-	{
+int
+spawn (const struct spawn_args *sa, int n, pid_t *pids)
+{
+	struct spawn_args a;
+	struct arg_block *args;
+	struct spawn_fd *fds = NULL;
+	const char *file;
+	int i, ret = -1;
+
+	check_user_buffer(sa, sizeof *sa);
+	a = *sa;
+	if(n < 0 || n > SPAWN_MAX || a.argv == NULL
+	   || a.fd_cnt < 0 || a.fd_cnt > SPAWN_FD_MAX)
 		return -1;
+	// kernel이 user 주소로 직접 pid를 써 넣으므로 쓰기 가능한지 확인
+	check_user_writable_lazy(pids, n * sizeof *pids);
+
+	// argument와 environment는 한 번만 복사해서 모든 child가 공유
+	args = arg_block_create();
+	if(args == NULL)
+		return -1;
+	if(!add_user_strings(args, a.argv))
+		goto done;
+	args->argc = args->cnt;
+	if(args->argc == 0)
+		goto done;
+	if(a.envp != NULL && !add_user_strings(args, a.envp))
+		goto done;
+
+	file = args->strings;
+	if(a.file != NULL)
+	{
+		user_strlen(a.file);
+		file = a.file;
 	}
 
+	if(a.fd_cnt > 0)
+	{
+		check_user_buffer(a.fds, a.fd_cnt * sizeof *a.fds);
+		fds = malloc(a.fd_cnt * sizeof *fds);
+		if(fds == NULL)
+			goto done;
+		memcpy(fds, a.fds, a.fd_cnt * sizeof *fds);
+		for(i = 0; i < a.fd_cnt; i++)
+			if(fds[i].child_fd < 2)
+				goto done;
+	}
+
+	ret = process_spawn(file, args, fds, a.fd_cnt, pids, n);
+
+ done:
+	free(fds);
+	arg_block_destroy(args);
 	return ret;
 }
 
-bool openTest(const char *file)
+/* Returns descriptor FD for a new open file of what PCF refers
+   to, at the same position, or a null pointer if memory runs
+   out.  Must be called with fl held. */
+static struct custom_file *
+dup_custom_file(struct custom_file *pcf, int fd)
 {
-	lock_acquire(&fl);
-	struct file *f = filesys_open(file);
+	struct file *f;
+	struct custom_file *cf;
+
+	if(pcf->pipe != NULL)
+	{
+		cf = slab_alloc(&custom_file_cache);
+		if(cf == NULL)
+			return NULL;
+		pipe_reopen(pcf->pipe, pcf->end);
+		cf->f = NULL;
+		cf->d = NULL;
+		cf->is_dir = 0;
+		cf->pipe = pcf->pipe;
+		cf->end = pcf->end;
+		cf->fd = fd;
+		return cf;
+	}
+
+	f = file_reopen(pcf->f);
 	if(f == NULL)
+		return NULL;
+	cf = slab_alloc(&custom_file_cache);
+	if(cf == NULL)
 	{
-		lock_release(&fl);
-		return false;
+		file_close(f);
+		return NULL;
+	}
+	file_seek(f, file_tell(pcf->f));
+
+	cf->f = f;
+	cf->d = pcf->is_dir != 0 ? filesys_opendir(file_get_inode(f)) : NULL;
+	cf->is_dir = pcf->is_dir;
+	cf->pipe = NULL;
+	cf->fd = fd;
+	return cf;
+}
+
+/* Gives the current process its own open file for what PARENT
+   has open as PARENT_FD, as descriptor CHILD_FD.  Returns false
+   if PARENT_FD is not open or CHILD_FD is already taken. */
+bool
+inherit_fd (struct thread *parent, int parent_fd, int child_fd)
+{
+	struct thread *leader = thread_leader(thread_current());
+	struct custom_file *pcf, *cf = NULL;
+
+	lock_acquire(&fl);
+	pcf = find_custom_file(&parent->file_list, parent_fd);
+	if(pcf != NULL && find_custom_file(&leader->file_list, child_fd) == NULL)
+		cf = dup_custom_file(pcf, child_fd);
+	if(cf != NULL)
+	{
+		list_push_back(&leader->file_list, &cf->file_elem);
+
+		// 이후 open()이 CHILD_FD와 겹치지 않도록
+		if(leader->current_max_fd < child_fd)
+			leader->current_max_fd = child_fd;
 	}
-	file_close(f);
 	lock_release(&fl);
-	return true;
+	return cf != NULL;
+}
+
+/* Gives the current process, right after fork(), its own open
+   file for every descriptor PARENT has open, with the same
+   number and position, and for PARENT's executable.  Returns
+   false if memory runs out. */
+bool
+inherit_files (struct thread *parent)
+{
+	struct thread *t = thread_current();
+	struct list_elem *e;
+	bool success = true;
+
+	lock_acquire(&fl);
+	if(parent->executing_file != NULL)
+	{
+		t->executing_file = file_reopen(parent->executing_file);
+		if(t->executing_file != NULL)
+			file_deny_write(t->executing_file);
+		else
+			success = false;
+	}
+	for(e = list_begin(&parent->file_list);
+	    success && e != list_end(&parent->file_list); e = list_next(e))
+	{
+		struct custom_file *pcf = list_entry(e, struct custom_file, file_elem);
+		struct custom_file *cf = dup_custom_file(pcf, pcf->fd);
+		if(cf != NULL)
+			list_push_back(&t->file_list, &cf->file_elem);
+		else
+			success = false;
+	}
+	t->current_max_fd = parent->current_max_fd;
+	lock_release(&fl);
+	return success;
 }
 
 int
@@ -301,15 +641,17 @@ open (const char *filename)
 	//file_deny_write(f); // To prevent another file from writing
 	// -> start_process로 옮김
 
-	int new_fd = thread_current()->current_max_fd + 1;
-	thread_current()->current_max_fd += 1;
+	struct thread *leader = thread_leader(thread_current());
+	int new_fd = leader->current_max_fd + 1;
+	leader->current_max_fd += 1;
 
-	struct custom_file *cf = malloc(sizeof(struct custom_file));
+	struct custom_file *cf = slab_alloc(&custom_file_cache);
 	cf->f = f;
 	cf->d = d;
 	cf->is_dir = is_dir;
+	cf->pipe = NULL;
 	cf->fd = new_fd;
-	list_push_back(&thread_current()->file_list, &cf->file_elem);
+	list_push_back(&leader->file_list, &cf->file_elem);
 
 	lock_release(&fl);
 	return new_fd;
@@ -319,7 +661,7 @@ int
 filesize (int fd)
 {
 	struct custom_file *cf = get_custom_file(fd);
-	if(cf != NULL)
+	if(cf != NULL && cf->pipe == NULL)
 	{
 		lock_acquire(&fl);
 		off_t length = file_length(cf->f); // get file length
@@ -329,47 +671,92 @@ filesize (int fd)
 	return 0; // if(custom_file is null)
 }
 
+/* BUFFER is a user address. */
 int
 read (int fd, void *buffer, unsigned length)
 {
-	if(fd == 0) // stdin
-	{
-		unsigned i;
-		char *buf = (char *)buffer;
-		for(i=0; i<length; i++)
-			buf[i] = input_getc();
-		return length;
-	}
-	else
+	struct custom_file *cf = NULL;
+	struct file *f = NULL;
+	char *p = buffer;
+	unsigned done = 0;
+	char *kbuf;
+
+	if(fd != 0) // stdin이 아니면 file이나 pipe
 	{
-		struct custom_file *cf = get_custom_file(fd);
+		cf = get_custom_file(fd);
 		if(cf == NULL)
 			return -1;
+		if(cf->pipe != NULL)
+		{
+			// pipe는 user 주소로 직접 복사하거나 page를 넘겨줌
+			if(cf->end != PIPE_READ)
+				return -1;
+			check_user_writable_lazy(buffer, length);
+			return pipe_read(cf->pipe, buffer, length);
+		}
 		if(cf->is_dir == 1) // directory일 경우 읽기 불가
 			return -1;
-		struct file *f = cf->f;
+		f = cf->f;
 		if(f == NULL)
 			return -1;
+	}
 
-		lock_acquire(&fl);
-		int real_length = file_read(f, buffer, length);
-		lock_release(&fl);
-		return real_length;
+	// kernel buffer에 page 단위로 읽은 뒤 user 주소로 복사
+	// 기다리는 동안 fork()가 page를 다시 공유해도 copy-on-write fault로 복사됨
+	check_user_writable_lazy(buffer, length);
+	kbuf = palloc_get_page(0);
+	if(kbuf == NULL)
+		return -1;
+	while(done < length)
+	{
+		unsigned chunk = PGSIZE - pg_ofs(p);
+		size_t n;
+
+		if(chunk > length - done)
+			chunk = length - done;
+		if(f == NULL)
+			// stdin은 처음에만 기다리고 short read 허용
+			n = input_read(kbuf, chunk, done == 0);
+		else
+		{
+			lock_acquire(&fl);
+			n = file_read(f, kbuf, chunk);
+			lock_release(&fl);
+		}
+		// 기다리는 동안 다른 thread가 shm_unmap()으로 buffer를 없앴다면 실패
+		if(!process_copy_out(p, kbuf, n))
+		{
+			palloc_free_page(kbuf);
+			return -1;
+		}
+		done += n;
+		p += n;
+		if(n < chunk || (f == NULL && kbuf[n - 1] == '\n'))
+			break;
 	}
+	palloc_free_page(kbuf);
+	return done;
 }
 
+/* BUFFER is a user address. */
 int
 write (int fd, const void *buffer, unsigned length)
 {
 	if(fd == 1)	// stdout
 	{
-		unsigned i;
-		// 100 chars per putbuf
-		for(i=0; i<=length/100; i++)
-		{
-			int _len = (length - i*100) >= 100? 100 : (length - i*100);
+		const char *p = buffer;
+		unsigned left = length;
 
-			putbuf(&((const char *)buffer)[100*i], _len);
+		check_user_buffer(buffer, length);
+		// console이 한 번에 받으므로 page 단위로 putbuf (kernel 주소는 page 안에서만 연속)
+		while(left > 0)
+		{
+			unsigned chunk = PGSIZE - pg_ofs(p);
+			if(chunk > left)
+				chunk = left;
+			putbuf(convert_userp((void *)p), chunk);
+			p += chunk;
+			left -= chunk;
 		}
 		return length;
 	}
@@ -378,12 +765,20 @@ write (int fd, const void *buffer, unsigned length)
 		struct custom_file *cf = get_custom_file(fd);
 		if(cf == NULL)
 			return -1;
+		if(cf->pipe != NULL)
+		{
+			if(cf->end != PIPE_WRITE)
+				return -1;
+			check_user_buffer(buffer, length);
+			return pipe_write(cf->pipe, buffer, length);
+		}
 		if(cf->is_dir == 1) // directory일 경우 쓰기 불가
 			return -1;
 		struct file *f = cf->f;
 		if(f == NULL)
 			return -1;
 
+		buffer = convert_userp((void *)buffer);
 		lock_acquire(&fl);
 		int real_length = file_write(f, buffer, length);
 		lock_release(&fl);
@@ -395,7 +790,7 @@ void
 seek (int fd, unsigned position)
 {
 	struct custom_file *cf = get_custom_file(fd);
-	if(cf != NULL)
+	if(cf != NULL && cf->pipe == NULL)
 	{
 		lock_acquire(&fl);
 		file_seek(cf->f, position);
@@ -407,7 +802,7 @@ unsigned
 tell (int fd)
 {
 	struct custom_file *cf = get_custom_file(fd);
-	if(cf != NULL)
+	if(cf != NULL && cf->pipe == NULL)
 	{
 		lock_acquire(&fl);
 		off_t t = file_tell(cf->f);
@@ -422,6 +817,10 @@ void close_internal(struct custom_file *cf)
 {
 	//file_allow_write(cf->f);	file_close 내에서 이미 호출함
 
+	// pipe_close는 fl과 상관없이 pipe lock만 잡음
+	if(cf->pipe != NULL)
+		pipe_close(cf->pipe, cf->end);
+
 	lock_acquire(&fl);
 	file_close(cf->f);
 	if(cf->is_dir != 0)
@@ -429,11 +828,11 @@ void close_internal(struct custom_file *cf)
 		// inode open count는 file_close에서 한 번 줄이므로, 여기서는 dir free만
 		// dir_close를 하면 안됨
 		if(cf->d != NULL)
-			free(cf->d);
+			dir_free(cf->d);
 	}
-	lock_release(&fl);
 	list_remove(&cf->file_elem);
-	free(cf);
+	lock_release(&fl);
+	slab_free(&custom_file_cache, cf);
 }
 
 void close (int fd)
@@ -496,8 +895,306 @@ bool isdir(int fd)
 int inumber(int fd)
 {
 	struct custom_file *cf = get_custom_file(fd);
+	if(cf->pipe != NULL)
+		return -1;
 	if(cf->is_dir == 0)
 		return inode_get_inumber(file_get_inode(cf->f));
 	else
 		return inode_get_inumber(dir_get_inode(cf->d));
 }
+
+/* Creates a pipe and opens its read end as FDS[0] and its write
+   end as FDS[1].  FDS is a user address, and may straddle two
+   pages, so it is written through the user mapping. */
+int pipe(int fds[2])
+{
+	struct thread *leader = thread_leader(thread_current());
+	struct custom_file *cf[2];
+	struct pipe *p;
+	int kfds[2];
+	int i;
+
+	check_user_writable_lazy(fds, 2 * sizeof *fds);
+	p = pipe_create();
+	if(p == NULL)
+		return -1;
+	cf[0] = slab_alloc(&custom_file_cache);
+	cf[1] = slab_alloc(&custom_file_cache);
+	if(cf[0] == NULL || cf[1] == NULL)
+	{
+		if(cf[0] != NULL)
+			slab_free(&custom_file_cache, cf[0]);
+		if(cf[1] != NULL)
+			slab_free(&custom_file_cache, cf[1]);
+		pipe_close(p, PIPE_READ);
+		pipe_close(p, PIPE_WRITE);
+		return -1;
+	}
+
+	lock_acquire(&fl);
+	for(i = 0; i < 2; i++)
+	{
+		cf[i]->f = NULL;
+		cf[i]->d = NULL;
+		cf[i]->is_dir = 0;
+		cf[i]->pipe = p;
+		cf[i]->end = i == 0 ? PIPE_READ : PIPE_WRITE;
+		cf[i]->fd = kfds[i] = ++leader->current_max_fd;
+		list_push_back(&leader->file_list, &cf[i]->file_elem);
+	}
+	lock_release(&fl);
+	// 다른 user thread가 바로 close할 수 있으므로 cf 대신 복사해 둔 값을 씀
+	return process_copy_out(fds, kfds, sizeof kfds) ? 0 : -1;
+}
+
+/* A descriptor's entry in the wait queue it is polled on. */
+struct poll_entry
+{
+	struct pollfd pfd;	// user의 fds[i]를 복사해 둔 것
+	struct wait_entry e;
+	bool added;		// e가 wait queue에 들어갔는지
+	struct pipe *pipe;	// e가 들어간 pipe, close되어도 pipe_unpoll() 전까지 남아 있음
+};
+
+/* Returns the events ready on descriptor FD, of those in EVENTS
+   and the ones always reported.  If W is non-null, also makes W
+   wait, through PE, for FD to change. */
+static unsigned
+poll_fd(int fd, unsigned events, struct poll_entry *pe, struct waiter *w)
+{
+	unsigned ready;
+
+	if(fd == 0) // stdin
+	{
+		ready = input_poll(&pe->e, w) ? POLLIN : 0;
+		if(w != NULL)
+			pe->added = true;
+	}
+	else if(fd == 1) // stdout
+		ready = POLLOUT;
+	else
+	{
+		struct custom_file *cf = get_custom_file(fd);
+		if(cf == NULL)
+			return POLLNVAL;
+		if(cf->pipe != NULL)
+		{
+			ready = pipe_poll(cf->pipe, cf->end, &pe->e, w);
+			if(w != NULL)
+			{
+				pe->added = true;
+				pe->pipe = cf->pipe;
+			}
+		}
+		else
+			ready = POLLIN | POLLOUT;	// file은 기다리는 일이 없음
+	}
+	return ready & (events | POLLERR | POLLHUP | POLLNVAL);
+}
+
+/* Waits until one of the NFDS descriptors in FDS, a user
+   address, is ready, for at most TIMEOUT milliseconds unless
+   TIMEOUT is negative.  Sets every revents and returns the number
+   of descriptors that are ready, 0 on timeout or if the process
+   starts going down, or -1 on error. */
+int poll(struct pollfd *fds, int nfds, int timeout)
+{
+	struct poll_entry *entries = NULL;
+	struct wait_entry exit_e;
+	struct waiter w;
+	struct waiter *reg = timeout != 0 ? &w : NULL;
+	int64_t deadline = timer_ticks() + ((int64_t)timeout * TIMER_FREQ + 999) / 1000;
+	int64_t ticks;
+	int i, cnt;
+
+	if(nfds < 0 || nfds > POLL_MAX)
+		return -1;
+	check_user_writable_lazy(fds, nfds * sizeof *fds);
+	if(nfds > 0)
+	{
+		entries = malloc(nfds * sizeof *entries);
+		if(entries == NULL)
+			return -1;
+	}
+
+	// fds는 기다리는 동안 shm_unmap()될 수 있으므로 kernel에 복사해 두고 씀
+	if(!process_pin_user(fds, nfds * sizeof *fds, false))
+	{
+		free(entries);
+		return -1;
+	}
+	for(i = 0; i < nfds; i++)
+		entries[i].pfd = fds[i];
+	process_unpin_user();
+
+	// 처음 한 번만 wait queue에 등록하고, 이후에는 깨어날 때마다 다시 검사
+	// process가 종료 중이면 기다리지 않음
+	waiter_init(&w);
+	if(reg != NULL)
+		process_poll_exit(&exit_e, &w);
+	for(i = 0; i < nfds; i++)
+	{
+		entries[i].added = false;
+		entries[i].pipe = NULL;
+	}
+	for(;;)
+	{
+		cnt = 0;
+		for(i = 0; i < nfds; i++)
+		{
+			unsigned ready = 0;
+			if(entries[i].pfd.fd >= 0)
+				ready = poll_fd(entries[i].pfd.fd, entries[i].pfd.events, &entries[i], reg);
+			entries[i].pfd.revents = ready;
+			if(ready != 0)
+				cnt++;
+		}
+		reg = NULL;
+		if(cnt > 0 || timeout == 0 || process_poll_exit(NULL, NULL))
+			break;
+		ticks = -1;
+		if(timeout > 0)
+		{
+			ticks = deadline - timer_ticks();
+			if(ticks <= 0)
+				break;
+		}
+		waiter_sleep(&w, ticks);
+	}
+
+	for(i = 0; i < nfds; i++)
+		if(entries[i].pipe != NULL)
+			pipe_unpoll(entries[i].pipe, &entries[i].e);
+		else if(entries[i].added)
+			wait_queue_remove(&entries[i].e);
+	if(timeout != 0)
+		wait_queue_remove(&exit_e);
+
+	if(process_pin_user(fds, nfds * sizeof *fds, true))
+	{
+		for(i = 0; i < nfds; i++)
+			fds[i].revents = entries[i].pfd.revents;
+		process_unpin_user();
+	}
+	else
+		cnt = -1;
+	free(entries);
+	return cnt;
+}
+
+int console_mode(int mode)
+{
+	if(mode != CONSOLE_CANONICAL && mode != CONSOLE_RAW)
+		return -1;
+	return input_set_canonical(mode == CONSOLE_CANONICAL) ? CONSOLE_CANONICAL : CONSOLE_RAW;
+}
+
+/* Copies the segment name NAME, a user address, into KNAME.
+   Returns false if it is too long to be a segment name. */
+static bool
+copy_shm_name(char kname[SHM_NAME_MAX + 1], const char *name)
+{
+	if(user_strlen(name) > SHM_NAME_MAX)
+		return false;
+	strlcpy(kname, name, SHM_NAME_MAX + 1);
+	return true;
+}
+
+void *shm_map(const char *name, size_t size)
+{
+	char kname[SHM_NAME_MAX + 1];
+
+	if(!copy_shm_name(kname, name))
+		return NULL;
+	return shm_attach(kname, size);
+}
+
+bool shm_unmap(void *addr)
+{
+	return shm_detach(addr);
+}
+
+bool shm_unlink(const char *name)
+{
+	char kname[SHM_NAME_MAX + 1];
+
+	if(!copy_shm_name(kname, name))
+		return false;
+	return shm_remove(kname);
+}
+
+/* SCHED_FIFO threads are never preempted by their equals, kernel
+   threads included, so only the initial process, started by the
+   kernel, may ask for it. */
+bool sched_setclass(int class, int time_slice)
+{
+	struct child *c;
+	enum intr_level old_level;
+	bool allowed = true;
+
+	if(class < 0)
+		return false;
+	if(class == SCHED_FIFO)
+	{
+		// parent가 종료되면 myself가 NULL이 되므로 interrupt를 끄고 확인
+		old_level = intr_disable();
+		c = thread_leader(thread_current())->myself;
+		allowed = c != NULL && ! c->parent->is_process;
+		intr_set_level(old_level);
+	}
+	return allowed && thread_set_sched_class(class, time_slice);
+}
+
+int sched_getclass(void)
+{
+	return thread_get_sched_class();
+}
+
+/* ADDR is a user address.  a misaligned word could straddle two
+   pages.  fork 후 copy-on-write로 공유 중인 page는 key를 만들기 전에
+   먼저 복사해서 이 process만의 page로 만듦 */
+int futex_wait(int *addr, int val)
+{
+	if((unsigned)addr % sizeof(int) != 0)
+		return -1;
+	check_user_writable(addr, sizeof *addr);
+	return futex_block(addr, val) ? 0 : -1;
+}
+
+int futex_wake(int *addr, int cnt)
+{
+	if((unsigned)addr % sizeof(int) != 0 || cnt < 0)
+		return -1;
+	check_user_writable(addr, sizeof *addr);
+	return futex_wakeup(addr, cnt);
+}
+
+int create_uthread(void *start, void *func, void *arg)
+{
+	tid_t tid = process_create_thread(start, func, arg);
+	return tid == TID_ERROR ? -1 : tid;
+}
+
+int uthread_join(int tid)
+{
+	return process_wait(tid);
+}
+
+/* the main thread has nobody to hand the process to,
+   so it exits the process as exit() does */
+void uthread_exit(int status)
+{
+	struct thread *t = thread_current();
+	if(t->leader == NULL)
+		exit(status);
+
+	t->myself->exit_status = status;
+	thread_exit();
+}
+
+void memprof(void)
+{
+#ifdef MEMPROF
+	memprof_print_stats();
+#endif
+}
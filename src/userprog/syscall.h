@@ -15,8 +15,8 @@ void syscall_init (void);
 void halt (void);
 void exit (int);
 pid_t exec (const char *);
-bool openTest (const char *);
 int wait (pid_t);
+pid_t waitpid (pid_t, int *, int);
 bool create (const char *, unsigned);
 bool remove (const char *);
 int open (const char *);
@@ -34,4 +34,27 @@ bool readdir(int, char[READDIR_MAX_LEN]);
 bool isdir(int);
 int inumber(int);
 
+bool sched_setclass(int, int);
+int sched_getclass(void);
+
+int futex_wait(int *, int);
+int futex_wake(int *, int);
+
+int create_uthread(void *, void *, void *);
+int uthread_join(int);
+void uthread_exit(int) NO_RETURN;
+
+int spawn(const struct spawn_args *, int, pid_t *);
+bool inherit_fd(struct thread *, int, int);
+bool inherit_files(struct thread *);
+
+int pipe(int[2]);
+int poll(struct pollfd *, int, int);
+int console_mode(int);
+void *shm_map(const char *, size_t);
+bool shm_unmap(void *);
+bool shm_unlink(const char *);
+
+void memprof(void);
+
 #endif /* userprog/syscall.h */